@@ -0,0 +1,598 @@
+// Microbenchmarks of the import, texture, uniform, transform, camera and
+// frame submission paths. Run from the project folder so that the shaders
+// are found, results are written as JSON:
+//
+//   ./viewer_bench [--filter name] [--output results.json]
+//                  [--meshes 1000,10000,100000]
+//
+// --check instead compares the culling and picking hierarchy against brute
+// force and exits with a non-zero status on a mismatch, without a context
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Graphics Libraries
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glad/glad.h>
+
+// Project Libraries
+#include "block_compression.h"
+#include "bvh.h"
+#include "camera.h"
+#include "debug.h"
+#include "frustum.h"
+#include "headless_context.h"
+#include "image_writer.h"
+#include "mesh_cache.h"
+#include "mip_generator.h"
+#include "model.h"
+#include "object_transforms.h"
+#include "render_target.h"
+#include "uniform_buffer.h"
+#include "viewer.h"
+
+struct BenchResult {
+   std::string name;
+   size_t iterations;
+   double min, mean, p99; // Nanoseconds per operation
+};
+
+struct BenchOptions {
+   std::string filter;
+   std::string outputPath;
+   std::vector<int> meshCounts = {1000, 10000, 100000};
+
+   // Each benchmark runs at least this long and this many iterations
+   double minSeconds = 0.5;
+   size_t minIterations = 5;
+
+   // Runs checkBvh instead of the benchmarks
+   bool check = false;
+};
+
+static BenchOptions options;
+static std::vector<BenchResult> results;
+
+// Keeps results of otherwise unused computations alive
+static volatile float sink;
+
+/// Times body until both minimums are reached, body performs operations
+/// operations per call
+static void run(const std::string &name, const std::function<void()> &body,
+                size_t operations = 1) {
+   if (name.find(options.filter) == std::string::npos)
+      return;
+
+   using Clock = std::chrono::steady_clock;
+   std::vector<double> samples;
+   const Clock::time_point begin = Clock::now();
+   while (samples.size() < options.minIterations ||
+          std::chrono::duration<double>(Clock::now() - begin).count() <
+              options.minSeconds) {
+      const Clock::time_point start = Clock::now();
+      body();
+      const std::chrono::duration<double, std::nano> elapsed =
+          Clock::now() - start;
+      samples.push_back(elapsed.count() / operations);
+   }
+
+   std::sort(samples.begin(), samples.end());
+   double total = 0.0;
+   for (double sample : samples)
+      total += sample;
+
+   BenchResult result = {name, samples.size(), samples.front(),
+                         total / samples.size(),
+                         samples[(samples.size() * 99 + 99) / 100 - 1]};
+   std::fprintf(stderr, "%-32s %8zu iterations %14.1f ns avg\n", name.c_str(),
+                result.iterations, result.mean);
+   results.push_back(result);
+}
+
+/// --- Synthetic Data ---
+/// UV sphere with normals, texture coordinates and tangents, like an import
+/// with aiProcess_CalcTangentSpace
+static aiMesh *createSphere(unsigned int resolution) {
+   aiMesh *mesh = new aiMesh();
+   const unsigned int rowSize = resolution + 1;
+   mesh->mNumVertices = rowSize * rowSize;
+   mesh->mVertices = new aiVector3D[mesh->mNumVertices];
+   mesh->mNormals = new aiVector3D[mesh->mNumVertices];
+   mesh->mTangents = new aiVector3D[mesh->mNumVertices];
+   mesh->mBitangents = new aiVector3D[mesh->mNumVertices];
+   mesh->mTextureCoords[0] = new aiVector3D[mesh->mNumVertices];
+   mesh->mNumUVComponents[0] = 2;
+
+   for (unsigned int i = 0; i < rowSize; i++) {
+      for (unsigned int j = 0; j < rowSize; j++) {
+         const float theta = glm::pi<float>() * i / resolution;
+         const float phi = glm::two_pi<float>() * j / resolution;
+         const aiVector3D normal(sin(theta) * cos(phi), cos(theta),
+                                 sin(theta) * sin(phi));
+         const unsigned int v = i * rowSize + j;
+         mesh->mVertices[v] = normal;
+         mesh->mNormals[v] = normal;
+         mesh->mTangents[v] = aiVector3D(-sin(phi), 0.0f, cos(phi));
+         mesh->mBitangents[v] = normal ^ mesh->mTangents[v];
+         mesh->mTextureCoords[0][v] =
+             aiVector3D(float(j) / resolution, float(i) / resolution, 0.0f);
+      }
+   }
+
+   mesh->mNumFaces = resolution * resolution * 2;
+   mesh->mFaces = new aiFace[mesh->mNumFaces];
+   for (unsigned int i = 0, f = 0; i < resolution; i++) {
+      for (unsigned int j = 0; j < resolution; j++) {
+         const unsigned int a = i * rowSize + j, b = a + 1;
+         const unsigned int c = a + rowSize, d = c + 1;
+         const unsigned int indices[6] = {a, c, b, b, c, d};
+         for (int k = 0; k < 6; k += 3, f++) {
+            mesh->mFaces[f].mNumIndices = 3;
+            mesh->mFaces[f].mIndices = new unsigned int[3];
+            std::copy(indices + k, indices + k + 3, mesh->mFaces[f].mIndices);
+         }
+      }
+   }
+   return mesh;
+}
+
+/// count boxes on a square grid filling the default view, written as a mesh
+/// cache next to an empty source file so that Model loads them directly
+static std::string createScene(const std::filesystem::path &directory,
+                               int count) {
+   const std::string path =
+       (directory / ("scene_" + std::to_string(count) + ".obj")).string();
+   {
+      std::ofstream source(path);
+      source << "# " << count << " synthetic boxes\n";
+   }
+
+   const int side = int(std::ceil(std::sqrt(float(count))));
+   const float spacing = 2.0f / side;
+   const float size = spacing * 0.35f;
+
+   std::vector<MeshData> meshes(count);
+   std::vector<uint32_t> order(count);
+   for (int m = 0; m < count; m++) {
+      const glm::vec3 center(-1.0f + spacing * (m % side + 0.5f),
+                             -1.0f + spacing * (m / side + 0.5f), 0.0f);
+
+      // Four vertices per face for flat normals
+      MeshData &data = meshes[m];
+      for (int axis = 0; axis < 3; axis++) {
+         for (float sign : {-1.0f, 1.0f}) {
+            glm::vec3 normal(0.0f), u(0.0f), v(0.0f);
+            normal[axis] = sign;
+            u[(axis + 1) % 3] = 1.0f;
+            v[(axis + 2) % 3] = 1.0f;
+
+            const GLuint first = GLuint(data.vertices.size());
+            for (int corner = 0; corner < 4; corner++) {
+               const float s = corner & 1 ? 1.0f : -1.0f;
+               const float t = corner & 2 ? 1.0f : -1.0f;
+               Vertex vertex = {};
+               vertex.Position = center + size * (normal + s * u + t * v);
+               vertex.Normal = normal;
+               vertex.TexCoords = glm::vec2(s, t) * 0.5f + 0.5f;
+               vertex.Tangent = u;
+               vertex.Bitangent = v;
+               data.vertices.push_back(vertex);
+            }
+
+            // Counter clockwise seen from outside
+            if (sign > 0.0f)
+               data.indices.insert(data.indices.end(),
+                                   {first, first + 1, first + 3, first,
+                                    first + 3, first + 2});
+            else
+               data.indices.insert(data.indices.end(),
+                                   {first, first + 3, first + 1, first,
+                                    first + 2, first + 3});
+         }
+      }
+      data.bounds = computeBounds(data.vertices.data(), data.vertices.size());
+      order[m] = uint32_t(m);
+   }
+
+   MeshCache::write(path, modelImportFlags, meshes, order);
+   return path;
+}
+
+/// --- Benchmarks ---
+static void benchProcessMesh() {
+   for (unsigned int resolution : {16u, 64u, 256u}) {
+      aiScene scene;
+      scene.mNumMeshes = 1;
+      scene.mMeshes = new aiMesh *[1]{createSphere(resolution)};
+      scene.mNumMaterials = 1;
+      scene.mMaterials = new aiMaterial *[1]{new aiMaterial()};
+
+      const std::string name =
+          "processMesh/" +
+          std::to_string(scene.mMeshes[0]->mNumVertices) + "_vertices";
+      run(name, [&scene]() {
+         MeshData data = Model::processMesh(scene.mMeshes[0], &scene);
+         sink = data.bounds.radius;
+      });
+   }
+}
+
+static void benchTextureDecode(const std::filesystem::path &directory,
+                               GlState &glState) {
+   // Model::TextureFromFile hands the file to the TextureLoader, this covers
+   // the decode on a worker and the upload
+   ThreadPool workers;
+   TextureLoader loader(workers, glState);
+   for (int size : {256, 1024}) {
+      const std::string path =
+          (directory / ("texture_" + std::to_string(size) + ".png")).string();
+      std::vector<uint8_t> pixels(size_t(size) * size * 3);
+      for (size_t i = 0; i < pixels.size(); i++)
+         pixels[i] = uint8_t(i * 7 ^ i >> 9);
+      writePNG(path, size, size, pixels);
+
+      run("textureDecode/" + std::to_string(size),
+          [&loader, &path, &glState]() {
+             GLuint texture = loader.load(path);
+             while (!loader.idle()) {
+                if (loader.upload() == 0)
+                   std::this_thread::yield();
+             }
+             glFinish();
+             glState.deleteTextures(1, &texture);
+          });
+   }
+
+   // Block compression of a noisy 256x256 level, done once per map at import
+   const int size = 256;
+   std::vector<uint8_t> rgba(size_t(size) * size * 4);
+   for (size_t i = 0; i < rgba.size(); i++)
+      rgba[i] = uint8_t(i * 7 ^ i >> 9);
+
+   const std::pair<const char *, BlockFormat> formats[] = {
+       {"bc1", BlockFormat::BC1},
+       {"bc5", BlockFormat::BC5},
+       {"bc7", BlockFormat::BC7}};
+   for (const auto &format : formats) {
+      std::vector<uint8_t> blocks(compressedSize(format.second, size, size));
+      run(std::string("textureCompress/") + format.first,
+          [&rgba, &blocks, &format]() {
+             compressImage(rgba.data(), size, size, format.second,
+                           blocks.data());
+          });
+   }
+
+   // Kaiser filtered mip chain of the same level, in linear light
+   run("mipChain/256", [&rgba]() {
+      MipChain chain = generateMipChain(rgba.data(), size, size,
+                                        TextureKind::Color);
+      sink = chain.data.back();
+   });
+   run("mipChain/256_pool", [&rgba, &workers]() {
+      MipChain chain = generateMipChain(rgba.data(), size, size,
+                                        TextureKind::Color, &workers);
+      sink = chain.data.back();
+   });
+}
+
+static void benchUniforms(GlState &glState) {
+   const size_t operations = 1000;
+
+   // The blocks of one frame with a model and the lamp
+   UniformBuffer uniforms(2, glState);
+   const FrameBlock frame = {glm::mat4(1.0f), glm::mat4(1.0f),
+                             glm::vec4(0.0f)};
+   const LightBlock light = {glm::vec4(1.0f), glm::vec4(0.2f),
+                             glm::vec4(1.0f), glm::vec4(1.0f)};
+   const ObjectBlock object =
+       computeObjectTransforms(glm::mat4(1.0f), glm::mat4(1.0f));
+   run("uniforms/blocks", [&]() {
+      for (size_t i = 0; i < operations; i++) {
+         uniforms.begin();
+         uniforms.setFrame(frame);
+         uniforms.setLight(light);
+         uniforms.setObject(0, object);
+         uniforms.setObject(1, object);
+         uniforms.bindObject(0);
+         uniforms.fence();
+      }
+   }, operations);
+
+   // The per mesh uniforms Mesh::Draw sets through the ShaderPipeline
+   ShaderPipeline pipeline(ShaderPaths{"src/shaders/modelShader.vert",
+                                       "src/shaders/modelShader.frag",
+                                       {packedVerticesDefine}},
+                           glState);
+   pipeline.use();
+   const UniformHandle boundsMin = pipeline.getUniform("meshBoundsMin");
+   const UniformHandle boundsExtent = pipeline.getUniform("meshBoundsExtent");
+   const UniformHandle material = pipeline.getUniform("materialIndex");
+   const GLfloat vector[3] = {1.0f, 1.0f, 1.0f};
+
+   run("uniforms/handles", [&]() {
+      for (size_t i = 0; i < operations; i++) {
+         pipeline.setVec3(boundsMin, vector);
+         pipeline.setVec3(boundsExtent, vector);
+         pipeline.setInt(material, 0);
+      }
+   }, operations);
+
+   run("uniforms/names", [&]() {
+      for (size_t i = 0; i < operations; i++) {
+         pipeline.setVec3("meshBoundsMin", vector);
+         pipeline.setVec3("meshBoundsExtent", vector);
+         pipeline.setInt("materialIndex", 0);
+      }
+   }, operations);
+}
+
+static void benchTransforms() {
+   const size_t operations = 10000;
+
+   // Instance matrices of a grid, as the viewer builds them
+   std::vector<glm::mat4> models(operations);
+   for (size_t i = 0; i < operations; i++)
+      models[i] = glm::translate(
+          glm::mat4(1.0f), glm::vec3(float(i % 100), 0.0f, float(i / 100)));
+   const glm::mat4 viewProjection =
+       glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+   std::vector<ObjectTransforms> transforms(operations);
+
+   run("objectTransforms/scalar", [&]() {
+      for (size_t i = 0; i < operations; i++)
+         transforms[i] = computeObjectTransforms(models[i], viewProjection);
+      sink = transforms[operations - 1].normalMatrix[0][0];
+   }, operations);
+
+   run("objectTransforms/batched", [&]() {
+      computeObjectTransforms(models.data(), operations, viewProjection,
+                              transforms.data());
+      sink = transforms[operations - 1].normalMatrix[0][0];
+   }, operations);
+}
+
+static void benchCamera() {
+   Camera camera;
+   const size_t operations = 10000;
+
+   run("camera/getView", [&]() {
+      float sum = 0.0f;
+      for (size_t i = 0; i < operations; i++) {
+         camera.Position.x = float(i);
+         sum += camera.getView()[3][0];
+      }
+      sink = sum;
+   }, operations);
+
+   run("camera/getProjection", [&]() {
+      float sum = 0.0f;
+      for (size_t i = 0; i < operations; i++)
+         sum += camera.getProjection(1.0f + i * 1e-6f, 0.1f, 100.0f)[0][0];
+      sink = sum;
+   }, operations);
+}
+
+static void benchFrame(const std::filesystem::path &directory,
+                       const RenderTarget &target) {
+   for (int count : options.meshCounts) {
+      const std::string suffix = "/" + std::to_string(count) + "_meshes";
+      if (("frame" + suffix).find(options.filter) == std::string::npos &&
+          ("submit" + suffix).find(options.filter) == std::string::npos)
+         continue;
+
+      ViewerOptions viewerOptions;
+      viewerOptions.modelPath = createScene(directory, count);
+      Viewer viewer(viewerOptions);
+
+      Camera camera;
+      target.bind();
+
+      for (bool batch : {false, true}) {
+         const std::string path = batch ? "Batch" : "";
+
+         // CPU side only, the driver may still be busy with earlier frames
+         run("submit" + path + suffix, [&]() {
+            viewer.renderFrame(camera, target.getWidth(), target.getHeight(),
+                               batch);
+         });
+         glFinish();
+
+         run("frame" + path + suffix, [&]() {
+            viewer.renderFrame(camera, target.getWidth(), target.getHeight(),
+                               batch);
+            glFinish();
+         });
+      }
+   }
+}
+
+/// --- Checks ---
+// Entry distance of the ray into the box like Bvh::raycast, or infinity
+static float rayDistance(const Aabb &box, const glm::vec3 &origin,
+                         const glm::vec3 &inverse) {
+   const glm::vec3 t0 = (box.min - origin) * inverse;
+   const glm::vec3 t1 = (box.max - origin) * inverse;
+   const glm::vec3 near = glm::min(t0, t1);
+   const glm::vec3 far = glm::max(t0, t1);
+
+   const float distance = std::max({near.x, near.y, near.z, 0.0f});
+   if (distance > std::min({far.x, far.y, far.z}))
+      return std::numeric_limits<float>::infinity();
+   return distance;
+}
+
+/// Culls random views and casts random rays through a hierarchy over random
+/// boxes and compares the results with testing every box, once after the
+/// build and once after moving all boxes and refitting
+static bool checkBvh() {
+   const size_t count = 200000;
+   std::mt19937 random(1);
+   std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+   std::uniform_real_distribution<float> size(0.1f, 2.0f);
+   auto randomVector = [&random](std::uniform_real_distribution<float> &axis) {
+      return glm::vec3(axis(random), axis(random), axis(random));
+   };
+
+   std::vector<Aabb> boxes(count);
+   for (Aabb &box : boxes) {
+      box.min = randomVector(position);
+      box.max = box.min + randomVector(size);
+   }
+
+   ThreadPool workers;
+   Bvh bvh;
+   bvh.build(boxes, &workers);
+   const std::vector<uint32_t> &order = bvh.order();
+
+   const glm::mat4 projection =
+       glm::perspective(glm::radians(45.0f), 1.5f, 0.1f, 100.0f);
+   const glm::vec3 up(0.0f, 1.0f, 0.0f);
+   bool matched = true;
+   for (int pass = 0; pass < 2; pass++) {
+      if (pass == 1) {
+         // Moves every box, the topology stays
+         std::uniform_real_distribution<float> offset(-5.0f, 5.0f);
+         for (Aabb &box : boxes) {
+            const glm::vec3 move = randomVector(offset);
+            box.min += move;
+            box.max += move;
+         }
+         bvh.refit(boxes);
+      }
+
+      size_t mismatches = 0;
+      for (int view = 0; view < 32; view++) {
+         const glm::vec3 eye = randomVector(position);
+         const Frustum frustum(projection *
+                               glm::lookAt(eye, randomVector(position), up));
+
+         std::vector<uint8_t> visible(count, 0);
+         bvh.cull(frustum, [&](uint32_t first, uint32_t rangeCount,
+                               bool inside) {
+            for (uint32_t i = first; i < first + rangeCount; i++) {
+               const Aabb &box = boxes[order[i]];
+               visible[order[i]] =
+                   inside || frustum.intersects(box.min, box.max);
+            }
+         });
+         for (size_t i = 0; i < count; i++) {
+            if (visible[i] != frustum.intersects(boxes[i].min, boxes[i].max))
+               mismatches++;
+         }
+
+         const glm::vec3 direction = randomVector(position);
+         const glm::vec3 inverse = 1.0f / direction;
+         float nearest = std::numeric_limits<float>::infinity();
+         for (const Aabb &box : boxes)
+            nearest = std::min(nearest, rayDistance(box, eye, inverse));
+
+         BvhHit hit;
+         const bool found = bvh.raycast(eye, direction, hit);
+         if (found != std::isfinite(nearest) ||
+             (found && hit.distance != nearest))
+            mismatches++;
+      }
+
+      debugMsg("Check", std::string(pass ? "Refit" : "Build") + ": " +
+                            std::to_string(mismatches) + " mismatches");
+      matched = matched && mismatches == 0;
+   }
+   return matched;
+}
+
+static bool writeResults(std::ostream &out) {
+   out << "{\n  \"context\": {\"renderer\": \""
+       << reinterpret_cast<const char *>(glGetString(GL_RENDERER))
+       << "\"},\n  \"benchmarks\": [";
+   for (size_t i = 0; i < results.size(); i++) {
+      const BenchResult &result = results[i];
+      char line[512];
+      std::snprintf(line, sizeof(line),
+                    "%s\n    {\"name\": \"%s\", \"iterations\": %zu, "
+                    "\"min_ns\": %.1f, \"mean_ns\": %.1f, \"p99_ns\": %.1f}",
+                    i ? "," : "", result.name.c_str(), result.iterations,
+                    result.min, result.mean, result.p99);
+      out << line;
+   }
+   out << "\n  ]\n}\n";
+   return bool(out);
+}
+
+int main(int argc, char **argv) {
+   for (int i = 1; i < argc; i++) {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+      if (arg == "--filter" && hasValue) {
+         options.filter = argv[++i];
+      } else if (arg == "--output" && hasValue) {
+         options.outputPath = argv[++i];
+      } else if (arg == "--meshes" && hasValue) {
+         options.meshCounts.clear();
+         std::istringstream counts(argv[++i]);
+         std::string count;
+         while (std::getline(counts, count, ','))
+            options.meshCounts.push_back(std::max(std::atoi(count.c_str()), 1));
+      } else if (arg == "--min-time" && hasValue) {
+         options.minSeconds = std::atof(argv[++i]);
+      } else if (arg == "--check") {
+         options.check = true;
+      } else {
+         debugMsg("Arguments", "Unknown option " + arg);
+      }
+   }
+
+   // stdout may carry the results
+   setDebugHandler([](const std::string &source, const std::string &message) {
+      std::cerr << "[DEBUG] " << source << ": " << message << "\n"
+                << std::flush;
+   });
+
+   if (options.check)
+      return checkBvh() ? 0 : -1;
+
+   // Any EGL driver works, LIBGL_ALWAYS_SOFTWARE=1 selects llvmpipe
+   HeadlessContext context;
+   if (!context.isValid())
+      return -1;
+
+   std::filesystem::path directory =
+       std::filesystem::temp_directory_path() / "3d.view-bench";
+   std::filesystem::create_directories(directory);
+
+   // The standalone benches share one cache, the viewers of benchFrame track
+   // the context with their own
+   GlState glState;
+   RenderTarget target(512, 512);
+   glState.setEnabled(GL_DEPTH_TEST, true);
+
+   benchProcessMesh();
+   benchTextureDecode(directory, glState);
+   benchUniforms(glState);
+   benchTransforms();
+   benchCamera();
+   benchFrame(directory, target);
+
+   std::filesystem::remove_all(directory);
+
+   if (options.outputPath.empty())
+      return writeResults(std::cout) ? 0 : -1;
+
+   std::ofstream file(options.outputPath);
+   return writeResults(file) ? 0 : -1;
+}
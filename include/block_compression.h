@@ -0,0 +1,59 @@
+//===-- block_compression.h - Block compression declarations -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declarations of the BC1, BC3, BC5 and BC7 block
+/// encoders, which compress RGBA8 images into the formats GL samples
+/// directly
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+// Graphics Libraries
+#include <glad/glad.h>
+
+// C++ Libraries
+#include <cstddef>
+#include <cstdint>
+
+/// S3TC formats are not core, the loader checks for the extension
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+/// BC1: RGB at 4 bits per texel. BC3: BC1 colors plus BC4 alpha. BC5: two
+/// BC4 channels, for normal maps. BC7: RGBA at 8 bits per texel, encoded in
+/// mode 6 only
+enum class BlockFormat : uint32_t { BC1, BC3, BC5, BC7 };
+
+/// Bytes of one 4x4 block
+size_t blockBytes(BlockFormat format);
+
+/// Bytes of an image of this size, partial blocks are padded
+size_t compressedSize(BlockFormat format, int width, int height);
+
+/// Internal format of glCompressedTextureSubImage3D. With srgb the colors
+/// are decoded to linear when sampled, BC5 has no sRGB variant
+GLenum blockInternalFormat(BlockFormat format, bool srgb = false);
+
+/// Compresses RGBA8 rows into compressedSize(format, width, height) bytes of
+/// blocks, row by row. Texels beyond the edge repeat the last row and column
+void compressImage(const uint8_t *rgba, int width, int height,
+                   BlockFormat format, uint8_t *blocks);
+
+#endif
@@ -0,0 +1,86 @@
+//===-- bvh.h - Bvh class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the Bvh class, which is responsible
+/// for the bounding volume hierarchy over mesh bounds used for hierarchical
+/// culling and ray picking
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef BVH_H
+#define BVH_H
+
+// Graphics Libraries
+#include <glm/glm.hpp>
+
+// C++ Libraries
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Project Libraries
+#include "frustum.h"
+#include "thread_pool.h"
+
+struct Aabb {
+   glm::vec3 min;
+   glm::vec3 max;
+};
+
+/// 32 bytes, two nodes per cache line. Interior nodes have count 0 and their
+/// children at leftFirst and leftFirst + 1, leaves cover count primitives
+/// starting at leftFirst in primitive order
+struct BvhNode {
+   glm::vec3 boundsMin;
+   uint32_t leftFirst;
+   glm::vec3 boundsMax;
+   uint32_t count;
+};
+
+struct BvhHit {
+   uint32_t primitive;
+   float distance;
+};
+
+/// Called for every leaf range touching the frustum, inside is set when the
+/// whole range is known to be visible
+using BvhVisitor =
+    std::function<void(uint32_t first, uint32_t count, bool inside)>;
+
+/// Leaves hold at most this many primitives, one AVX culling batch
+constexpr uint32_t bvhMaxLeafSize = cullBatchWidth;
+
+class Bvh {
+   std::vector<BvhNode> nodes;
+
+   // Original index and bounds of each primitive in leaf order
+   std::vector<uint32_t> primitives;
+   std::vector<Aabb> primitiveBounds;
+
+ public:
+   /// Binned SAH build. With a pool the top levels are split on this thread
+   /// and the subtrees below them are built on the workers
+   void build(const std::vector<Aabb> &boxes, ThreadPool *pool = nullptr);
+
+   /// Updates the bounds for moved primitives, indexed like the boxes passed
+   /// to build, without changing the tree topology
+   void refit(const std::vector<Aabb> &boxes);
+
+   void cull(const Frustum &frustum, const BvhVisitor &visitor) const;
+
+   /// Nearest primitive whose bounds the ray enters, direction need not be
+   /// normalized and distance is in units of it
+   bool raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                BvhHit &hit) const;
+
+   /// Original index of each primitive in leaf order
+   const std::vector<uint32_t> &order() const { return primitives; }
+   const std::vector<BvhNode> &getNodes() const { return nodes; }
+};
+
+#endif
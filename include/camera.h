@@ -47,12 +47,19 @@ class Camera {
 
    /// --- Direction ---
    void setDirection(const float &xoffset, const float &yoffset);
+   /// Turns towards a point, e.g. for scripted camera paths
+   void setTarget(const glm::vec3 &target);
 
    /// --- Projection ---
    void setZoom(const float &yoffset);
    glm::mat4 getView() const;
    glm::mat4 getProjection(const float &aspect, const float &nearPlane,
                            const float &farPlane) const;
+
+   /// --- Picking ---
+   /// World space ray through a point in normalized device coordinates
+   void getRay(const float &x, const float &y, const float &aspect,
+               glm::vec3 &origin, glm::vec3 &direction) const;
 };
 
 #endif
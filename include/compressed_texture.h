@@ -0,0 +1,102 @@
+//===-- compressed_texture.h - DdsCache class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the DdsCache class, which is
+/// responsible for block compressing images with their mip chains once and
+/// keeping the result in .dds files next to the source images
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef COMPRESSED_TEXTURE_H
+#define COMPRESSED_TEXTURE_H
+
+// C++ Libraries
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Project Libraries
+#include "block_compression.h"
+#include "mapped_file.h"
+#include "mip_generator.h"
+
+/// Bump whenever the encoders or the mip filter change
+constexpr uint32_t textureCacheVersion = 2;
+
+/// BC5 for normal maps. Colors take BC1, or BC3 with alpha, if the context
+/// samples S3TC, else BC7
+BlockFormat chooseBlockFormat(TextureKind kind, bool hasAlpha, bool s3tc);
+
+/// Blocks of every level down to 1x1, largest first and tightly packed
+struct CompressedImage {
+   BlockFormat format = BlockFormat::BC7;
+   std::vector<ImageLevel> levels;
+   std::vector<uint8_t> data;
+
+   bool empty() const { return levels.empty(); }
+};
+
+/// Compresses every level of a chain of generateMipChain
+CompressedImage compressMipChain(const MipChain &chain, BlockFormat format);
+
+/// File layout: "DDS ", DdsHeader, DdsHeaderDx10, then the levels. Other
+/// tools read the files as plain DX10 .dds, reserved words of the header
+/// identify the source image:
+///
+/// | reserved[0] | reserved[1] | reserved[2..3] |
+/// | "3DVT"      | version     | source hash    |
+struct DdsPixelFormat {
+   uint32_t size;
+   uint32_t flags;
+   uint32_t fourCC;
+   uint32_t bitCount;
+   uint32_t masks[4];
+};
+
+struct DdsHeader {
+   uint32_t magic;
+   uint32_t size;
+   uint32_t flags;
+   uint32_t height;
+   uint32_t width;
+   uint32_t linearSize;
+   uint32_t depth;
+   uint32_t mipCount;
+   uint32_t reserved[11];
+   DdsPixelFormat pixelFormat;
+   uint32_t caps[4];
+   uint32_t reserved2;
+};
+
+struct DdsHeaderDx10 {
+   uint32_t dxgiFormat;
+   uint32_t dimension;
+   uint32_t miscFlags;
+   uint32_t arraySize;
+   uint32_t miscFlags2;
+};
+
+class DdsCache {
+ public:
+   /// Maps the blocks cached for the source image with this hash and fills
+   /// in the levels of image, its data stays empty. Returns the blocks in
+   /// the mapping, or nullptr if the file is missing, corrupt or stale
+   static const uint8_t *map(const std::string &sourcePath,
+                             uint64_t sourceHash, MappedFile &file,
+                             CompressedImage &image);
+
+   static bool write(const std::string &sourcePath, uint64_t sourceHash,
+                     const CompressedImage &image);
+
+   static std::string cachePath(const std::string &sourcePath) {
+      return sourcePath + ".3dvcache.dds";
+   }
+};
+
+#endif
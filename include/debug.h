@@ -1,8 +1,16 @@
 #ifndef DEBUG_H
 #define DEBUG_H
 
+#include <functional>
 #include <string>
 
+using DebugHandler = std::function<void(const std::string &source,
+                                        const std::string &message)>;
+
 void debugMsg(std::string source, std::string error);
 
+/// Replaces the default handler, which prints to stdout. Set it before any
+/// threads report messages
+void setDebugHandler(DebugHandler handler);
+
 #endif
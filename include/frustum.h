@@ -0,0 +1,64 @@
+//===-- frustum.h - Frustum culling definitions -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the Frustum and CullingBounds
+/// classes, which are responsible for testing mesh bounds against the view
+/// volume before draws are issued
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+// Graphics Libraries
+#include <glm/glm.hpp>
+
+// C++ Libraries
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Project Libraries
+#include "mesh.h"
+
+/// Boxes tested per iteration of the widest culling loop
+constexpr size_t cullBatchWidth = 8;
+
+/// Planes (a, b, c, d) with ax + by + cz + d >= 0 inside of the volume
+struct Frustum {
+   glm::vec4 planes[6];
+
+   /// Extracts the planes of a view projection matrix (Gribb & Hartmann).
+   /// With a model matrix multiplied in, they are in that object space
+   explicit Frustum(const glm::mat4 &viewProjection);
+
+   bool intersects(const glm::vec3 &boundsMin,
+                   const glm::vec3 &boundsMax) const;
+};
+
+/// Mesh bounding boxes as structure of arrays, so that the culling loop
+/// tests four (SSE2) or eight (AVX) boxes against a plane at once
+class CullingBounds {
+   std::vector<float> centerX, centerY, centerZ;
+   std::vector<float> extentX, extentY, extentZ;
+   size_t count = 0;
+
+ public:
+   /// Stores the bounds of meshes[order[i]] at i, e.g. in Bvh::order
+   void assign(const std::vector<Mesh> &meshes,
+               const std::vector<uint32_t> &order);
+   size_t size() const { return count; }
+
+   /// Sets visible[i - first] to 1 for every box in [first, first +
+   /// rangeCount) intersecting the frustum. Boxes and frustum must share a
+   /// space
+   void cull(const Frustum &frustum, size_t first, size_t rangeCount,
+             uint8_t *visible) const;
+};
+
+#endif
@@ -0,0 +1,135 @@
+//===-- gl_state.h - GlState class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the GlState class, which is
+/// responsible for tracking the bindings and raster state of a context and
+/// filtering calls that would not change them. Bindings belong to their
+/// context, every object drawing with one shares its GlState
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+// Graphics Libraries
+#include <glad/glad.h>
+
+// C++ Libraries
+#include <cstddef>
+#include <vector>
+
+/// Texture units and indexed buffer binding points that are tracked, calls
+/// beyond them are always issued
+constexpr GLuint glStateTextureUnits = 16;
+constexpr GLuint glStateBufferBindings = 8;
+
+/// GL calls forwarded to the driver and the ones filtered as redundant
+struct GlStateCounters {
+   size_t issued = 0;
+   size_t filtered = 0;
+};
+
+class GlState {
+   // Tracked values, unknownName until a call through the cache set them
+   static constexpr GLuint unknownName = ~0u;
+
+   GLuint program = unknownName;
+   GLuint vertexArray = unknownName;
+   GLuint textures[glStateTextureUnits];
+
+   /// Non indexed buffer targets, GL_ELEMENT_ARRAY_BUFFER is part of the
+   /// vertex array and not tracked
+   struct BufferTarget {
+      GLenum target;
+      GLuint buffer;
+   };
+   std::vector<BufferTarget> buffers;
+
+   struct BufferRange {
+      GLuint buffer = unknownName;
+      GLintptr offset = 0;
+      GLsizeiptr size = 0;
+   };
+   BufferRange storageBuffers[glStateBufferBindings];
+   BufferRange uniformBuffers[glStateBufferBindings];
+
+   /// Capabilities of glEnable, known after their first toggle
+   struct Capability {
+      GLenum cap;
+      bool enabled;
+   };
+   std::vector<Capability> capabilities;
+
+   GLenum polygonMode = GL_NONE;
+   GLint depthMask = -1;
+   GLenum blendSource = GL_NONE, blendDestination = GL_NONE;
+   GLint unpackAlignment = -1;
+
+   // Calls before the first frame, e.g. while loading, are not counted
+   GlStateCounters frame, lastFrame, total;
+   size_t frames = 0;
+
+ public:
+   GlState() { invalidate(); }
+
+   /// Forgets everything, e.g. after a new context became current or code
+   /// outside of the cache changed state
+   void invalidate();
+
+   /// --- Bindings ---
+   void useProgram(GLuint program);
+   void bindVertexArray(GLuint vertexArray);
+
+   /// glBindTextureUnit, the texture is bound to its own target. Units are
+   /// only touched through here, the active unit stays GL_TEXTURE0
+   void bindTextureUnit(GLuint unit, GLuint texture);
+
+   /// glBindTextures, 0 unbinds every target of a unit
+   void bindTextures(GLuint first, GLsizei count, const GLuint *textures);
+
+   void bindBuffer(GLenum target, GLuint buffer);
+
+   /// GL_SHADER_STORAGE_BUFFER and GL_UNIFORM_BUFFER binding points
+   void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+   void bindBufferRange(GLenum target, GLuint index, GLuint buffer,
+                        GLintptr offset, GLsizeiptr size);
+
+   /// --- Deletion ---
+   /// Deleting unbinds an object, the cache has to know
+   void deleteProgram(GLuint program);
+   void deleteVertexArray(GLuint vertexArray);
+   void deleteTextures(GLsizei count, const GLuint *textures);
+   void deleteBuffers(GLsizei count, const GLuint *buffers);
+
+   /// --- Raster State ---
+   void setEnabled(GLenum cap, bool enabled);
+   void setPolygonMode(GLenum mode);
+   void setDepthMask(GLboolean mask);
+   void setBlendFunc(GLenum source, GLenum destination);
+   void setUnpackAlignment(GLint alignment);
+
+   /// --- Counters ---
+   /// Starts counting the calls of the next frame
+   void beginFrame();
+   const GlStateCounters &getLastFrame() const { return lastFrame; }
+
+   /// Logs the calls issued and filtered per frame
+   void report() const;
+
+ private:
+   bool changed(bool different) {
+      if (different)
+         frame.issued++;
+      else
+         frame.filtered++;
+      return different;
+   }
+   BufferRange *findRange(GLenum target, GLuint index);
+};
+
+#endif
@@ -0,0 +1,36 @@
+//===-- headless_context.h - HeadlessContext class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the HeadlessContext class, which is
+/// responsible for an OpenGL 4.5 context without a window through EGL, e.g.
+/// on Mesa's surfaceless platform with llvmpipe
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+// Graphics Libraries
+#include <EGL/egl.h>
+
+class HeadlessContext {
+   EGLDisplay display = EGL_NO_DISPLAY;
+   EGLContext context = EGL_NO_CONTEXT;
+
+ public:
+   /// Creates the context, makes it current and loads the GL functions
+   HeadlessContext();
+   ~HeadlessContext();
+
+   HeadlessContext(const HeadlessContext &) = delete;
+   HeadlessContext &operator=(const HeadlessContext &) = delete;
+
+   bool isValid() const { return context != EGL_NO_CONTEXT; }
+};
+
+#endif
@@ -0,0 +1,35 @@
+//===-- image_writer.h - Image file output -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the image writing functions, which
+/// are responsible for dumping rendered frames as binary PPM or PNG files
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+// C++ Libraries
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Pixels are tightly packed RGB rows, top row first
+bool writePPM(const std::string &path, int width, int height,
+              const std::vector<uint8_t> &pixels);
+
+/// Uncompressed (stored deflate blocks), so that frame dumps stay cheap and
+/// need no zlib
+bool writePNG(const std::string &path, int width, int height,
+              const std::vector<uint8_t> &pixels);
+
+/// Picks the format from the extension, PNG unless it is .ppm
+bool writeImage(const std::string &path, int width, int height,
+                const std::vector<uint8_t> &pixels);
+
+#endif
@@ -0,0 +1,73 @@
+//===-- instance_buffer.h - InstanceBuffer class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the InstanceBuffer class, which is
+/// responsible for streaming per instance transforms to the GPU through a
+/// persistently mapped storage buffer
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+// Graphics Libraries
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// C++ Libraries
+#include <cstddef>
+
+// Project Libraries
+#include "gl_state.h"
+#include "object_transforms.h"
+
+/// Shader define selecting the instanced path of the model shader
+constexpr const char *instancedDefine = "INSTANCED";
+
+/// Binding point of the InstanceTransforms storage block
+constexpr GLuint instanceTransformBinding = 2;
+
+/// Frames the CPU may write ahead of the GPU
+constexpr size_t instanceBufferRegions = 3;
+
+class InstanceBuffer {
+   GLuint buffer;
+   ObjectTransforms *mapped;
+
+   // Transforms per region and the aligned distance between regions
+   GLsizei capacity;
+   GLsizeiptr regionSize;
+
+   GLsync fences[instanceBufferRegions] = {};
+   size_t region = 0;
+   GLsizei count = 0;
+
+   GlState &glState;
+
+ public:
+   InstanceBuffer(GLsizei capacity, GlState &glState);
+   ~InstanceBuffer();
+
+   InstanceBuffer(const InstanceBuffer &) = delete;
+   InstanceBuffer &operator=(const InstanceBuffer &) = delete;
+
+   /// Waits until the GPU is done with the next region and returns it, room
+   /// for getCapacity() transforms
+   ObjectTransforms *begin();
+
+   /// Binds the first count transforms written since begin for drawing
+   void end(GLsizei count);
+
+   /// Marks the region as in use by the draws issued since end
+   void fence();
+
+   GLsizei getCapacity() const { return capacity; }
+   GLsizei size() const { return count; }
+};
+
+#endif
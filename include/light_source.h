@@ -9,6 +9,7 @@
 #include <vector>
 
 // Project Libraries
+#include "gl_state.h"
 #include "shader_pipeline.h"
 
 class LightSource {
@@ -16,6 +17,7 @@ class LightSource {
    std::vector<GLfloat> vertices;
    std::vector<GLuint> indices;
    GLuint VAO, VBO, EBO;
+   GlState &glState;
 
  public:
    glm::vec3 Position;
@@ -26,7 +28,7 @@ class LightSource {
    glm::vec3 Color = glm::vec3(1.0f);
 
  public:
-   LightSource(glm::vec3 Position);
+   LightSource(glm::vec3 Position, GlState &glState);
    void Draw();
 
  private:
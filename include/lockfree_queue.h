@@ -0,0 +1,107 @@
+//===-- lockfree_queue.h - LockFreeQueue class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the LockFreeQueue class, a bounded
+/// multi producer / multi consumer queue used to hand results from worker
+/// threads to the GL thread without taking locks
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LOCKFREE_QUEUE_H
+#define LOCKFREE_QUEUE_H
+
+// C++ Libraries
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/// Bounded queue after Dmitry Vyukov's design. Every cell carries a sequence
+/// number telling producers and consumers whose turn it is, so a push or pop
+/// is a single compare-and-swap on the shared position.
+template <typename T> class LockFreeQueue {
+   struct Cell {
+      std::atomic<size_t> sequence;
+      T data;
+   };
+
+   std::unique_ptr<Cell[]> cells;
+   size_t mask;
+
+   // Separate cache lines, producers and consumers should not false share
+   alignas(64) std::atomic<size_t> enqueuePos{0};
+   alignas(64) std::atomic<size_t> dequeuePos{0};
+
+ public:
+   /// Capacity is rounded up to the next power of two
+   explicit LockFreeQueue(size_t capacity) {
+      size_t size = 2;
+      while (size < capacity)
+         size <<= 1;
+
+      cells.reset(new Cell[size]);
+      mask = size - 1;
+      for (size_t i = 0; i < size; i++)
+         cells[i].sequence.store(i, std::memory_order_relaxed);
+   }
+
+   LockFreeQueue(const LockFreeQueue &) = delete;
+   LockFreeQueue &operator=(const LockFreeQueue &) = delete;
+
+   /// Returns false if the queue is full
+   bool push(T &&value) {
+      size_t pos = enqueuePos.load(std::memory_order_relaxed);
+      Cell *cell;
+      while (true) {
+         cell = &cells[pos & mask];
+         size_t sequence = cell->sequence.load(std::memory_order_acquire);
+         intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+
+         if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1,
+                                                 std::memory_order_relaxed))
+               break;
+         } else if (diff < 0) {
+            return false;
+         } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+         }
+      }
+
+      cell->data = std::move(value);
+      cell->sequence.store(pos + 1, std::memory_order_release);
+      return true;
+   }
+
+   /// Returns false if the queue is empty
+   bool pop(T &value) {
+      size_t pos = dequeuePos.load(std::memory_order_relaxed);
+      Cell *cell;
+      while (true) {
+         cell = &cells[pos & mask];
+         size_t sequence = cell->sequence.load(std::memory_order_acquire);
+         intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+
+         if (diff == 0) {
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1,
+                                                 std::memory_order_relaxed))
+               break;
+         } else if (diff < 0) {
+            return false;
+         } else {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+         }
+      }
+
+      value = std::move(cell->data);
+      cell->sequence.store(pos + mask + 1, std::memory_order_release);
+      return true;
+   }
+};
+
+#endif
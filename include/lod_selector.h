@@ -0,0 +1,49 @@
+//===-- lod_selector.h - LodSelector class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the LodSelector class, which is
+/// responsible for picking the level of detail of meshes from the screen space
+/// error of each level
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LOD_SELECTOR_H
+#define LOD_SELECTOR_H
+
+// Graphics Libraries
+#include <glm/glm.hpp>
+
+// C++ Libraries
+#include <cstddef>
+
+// Project Libraries
+#include "mesh.h"
+
+class LodSelector {
+   // Pixels covered by one world unit at distance one
+   float pixelScale = 1.0f;
+   float pixelThreshold;
+
+ public:
+   LodSelector(float pixelThreshold = 1.0f) : pixelThreshold(pixelThreshold) {}
+
+   /// Takes the field of view from projection, e.g. Camera::getProjection
+   void update(const glm::mat4 &projection, float viewportHeight);
+
+   /// Coarsest level whose error covers at most pixelThreshold pixels on
+   /// screen, measured at the point of the mesh bounds closest to viewPos
+   size_t select(const Mesh &mesh, const glm::mat4 &model,
+                 const glm::vec3 &viewPos) const;
+
+   /// Pixels the diameter of the mesh bounds spans on screen at their point
+   /// closest to viewPos, infinite from inside of them
+   float projectedSize(const Mesh &mesh, const glm::mat4 &model,
+                       const glm::vec3 &viewPos) const;
+};
+
+#endif
@@ -0,0 +1,46 @@
+//===-- mapped_file.h - MappedFile class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the MappedFile class, which is
+/// responsible for read only memory mapping of files such as caches, so that
+/// their contents can be handed to GL without intermediate copies
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+// C++ Libraries
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class MappedFile {
+   void *mapping = nullptr;
+   size_t length = 0;
+
+ public:
+   MappedFile() = default;
+   ~MappedFile() { close(); }
+
+   MappedFile(const MappedFile &) = delete;
+   MappedFile &operator=(const MappedFile &) = delete;
+
+   /// Maps the whole file, returns false if it can not be opened
+   bool open(const std::string &path, bool sequential = true);
+   void close();
+
+   bool isOpen() const { return mapping != nullptr; }
+   const uint8_t *data() const { return static_cast<uint8_t *>(mapping); }
+   size_t size() const { return length; }
+};
+
+/// 64-bit hash of a buffer, fast enough to key caches on file contents
+uint64_t hashBytes(const uint8_t *data, size_t size, uint64_t seed = 0);
+
+#endif
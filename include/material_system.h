@@ -0,0 +1,133 @@
+//===-- material_system.h - MaterialSystem class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the MaterialSystem class, which is
+/// responsible for the materials of a model and the records the shaders
+/// index per draw, the maps live in the shared TextureCache
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef MATERIAL_SYSTEM_H
+#define MATERIAL_SYSTEM_H
+
+// Graphics Libraries
+#include <glad/glad.h>
+
+// C++ Libraries
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Project Libraries
+#include "gl_state.h"
+#include "mesh.h"
+#include "texture_cache.h"
+
+/// Maps a material samples. Slot i is bound to texture unit i
+enum MaterialSlot : GLuint {
+   SLOT_DIFFUSE,
+   SLOT_SPECULAR,
+   SLOT_NORMAL,
+};
+constexpr GLuint materialSlots = 3;
+
+/// Flags of MaterialRecord, set once the map of a slot is resident
+enum MaterialFlags : GLuint {
+   MATERIAL_DIFFUSE = 1 << SLOT_DIFFUSE,
+   MATERIAL_SPECULAR = 1 << SLOT_SPECULAR,
+   MATERIAL_NORMAL = 1 << SLOT_NORMAL,
+};
+
+/// std430 layout of the Materials block, the layers index the arrays bound
+/// for the draw
+struct MaterialRecord {
+   GLuint flags;
+   GLuint layers[materialSlots];
+};
+
+/// Binding point of the Materials storage block
+constexpr GLuint materialRecordBinding = 3;
+
+/// Shader define of pipelines sampling diffuse maps as sRGB, they light in
+/// linear space and encode their output
+constexpr const char *gammaCorrectionDefine = "GAMMA_CORRECTION";
+
+/// Texture arrays of every slot of a material, 0 where the map is missing.
+/// Draws with equal arrays need no rebinding in between
+struct MaterialArrays {
+   GLuint textures[materialSlots] = {};
+
+   bool operator==(const MaterialArrays &other) const;
+   bool operator!=(const MaterialArrays &other) const {
+      return !(*this == other);
+   }
+   bool operator<(const MaterialArrays &other) const;
+
+   void bind(GlState &glState) const {
+      glState.bindTextures(0, materialSlots, textures);
+   }
+};
+
+class MaterialSystem {
+   // Map of every slot of a material, noTexture for none. Each holds a
+   // reference of the cache
+   struct Material {
+      TextureHandle textures[materialSlots];
+   };
+   std::vector<Material> materials;
+   std::vector<MaterialRecord> records;
+
+   // Materials sampling a map, updated when it becomes resident
+   std::unordered_map<TextureHandle, std::vector<GLuint>> users;
+
+   // Mirror of records, bound to materialRecordBinding
+   GLuint recordBuffer = 0;
+   size_t recordCapacity = 0;
+
+   // Bumped whenever a map becomes resident or an array moves
+   uint64_t generation = 0;
+
+   TextureCache &textureCache;
+   GlState &glState;
+   size_t listener;
+
+   // Diffuse maps are sampled as sRGB, see gammaCorrectionDefine
+   bool gammaCorrection;
+
+ public:
+   /// The cache has to outlive the system
+   MaterialSystem(TextureCache &textureCache, GlState &glState,
+                  bool gammaCorrection = false);
+   ~MaterialSystem();
+
+   MaterialSystem(const MaterialSystem &) = delete;
+   MaterialSystem &operator=(const MaterialSystem &) = delete;
+
+   /// Material index of these maps, identical sets share a material.
+   /// Paths are relative to directory
+   GLuint addMaterial(const std::vector<TextureRef> &refs,
+                      const std::string &directory);
+
+   /// Binds the material records, see materialRecordBinding
+   void bind() const;
+
+   /// Requests the levels of the maps of a material drawn this many pixels
+   /// across, see TextureCache::request
+   void request(GLuint material, float pixels) const;
+
+   MaterialArrays getArrays(GLuint material) const;
+   size_t size() const { return materials.size(); }
+   uint64_t getGeneration() const { return generation; }
+
+ private:
+   void resident(TextureHandle texture);
+   void updateRecord(GLuint material);
+};
+
+#endif
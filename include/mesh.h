@@ -20,40 +20,103 @@
 #include <glad/glad.h>
 
 // C++ Libraries
+#include <cstdint>
 #include <string>
 #include <vector>
 
 // Project Libraries
 #include "shader_pipeline.h"
+#include "vertex_format.h"
 
-struct Vertex {
-   glm::vec3 Position;
-   glm::vec3 Normal;
-   glm::vec2 TexCoords;
-   glm::vec3 Tangent;
-   glm::vec3 Bitangent;
-};
-
-struct Texture {
-   GLuint id;
+/// Texture referenced by a material, resolved to an array layer on upload,
+/// see MaterialSystem
+struct TextureRef {
    std::string type;
    std::string path;
 };
 
+/// Object space bounding box and the sphere around its center that encloses
+/// all vertices, shared by every level of detail
+struct MeshBounds {
+   glm::vec3 min = glm::vec3(0.0f);
+   glm::vec3 max = glm::vec3(0.0f);
+   glm::vec3 center = glm::vec3(0.0f);
+   float radius = 0.0f;
+};
+
+MeshBounds computeBounds(const Vertex *vertices, size_t count);
+
+/// Level of detail, a range of the index buffer drawn against the shared
+/// vertices. error is the object space deviation from level 0
+struct MeshLod {
+   uint32_t indexOffset;
+   uint32_t indexCount;
+   float error;
+};
+
+/// Non owning view of mesh geometry, e.g. into a memory mapped cache
+struct MeshView {
+   const Vertex *vertices = nullptr;
+   size_t vertexCount = 0;
+   const GLuint *indices = nullptr;
+   size_t indexCount = 0;
+   std::vector<TextureRef> textures;
+   std::vector<MeshLod> lods;
+   MeshBounds bounds;
+};
+
+/// CPU side mesh produced by the import workers, no GL calls involved
+struct MeshData {
+   std::vector<Vertex> vertices;
+   std::vector<GLuint> indices;
+   std::vector<TextureRef> textures;
+   std::vector<MeshLod> lods;
+   MeshBounds bounds;
+
+   MeshView view() const {
+      return {vertices.data(), vertices.size(), indices.data(), indices.size(),
+              textures, lods, bounds};
+   }
+};
+
 class Mesh {
    GLuint VAO, VBO, EBO;
 
  public:
-   Mesh(std::vector<Vertex> &vertices, std::vector<GLuint> &indices,
-        std::vector<Texture> &textures);
-   void Draw(ShaderPipeline &shaderPipeline);
+   Mesh(const MeshView &view, GLuint material,
+        VertexFormat format = VertexFormat::Full);
+   Mesh(const MeshData &data, GLuint material,
+        VertexFormat format = VertexFormat::Full)
+       : Mesh(data.view(), material, format) {}
+   /// Sets the per mesh uniforms and draws level lod. Expects its vertex
+   /// array and material bound, see RenderQueue::submit
+   void submit(const ShaderPipeline &shaderPipeline, size_t lod,
+               GLsizei instanceCount = 1) const;
 
-   std::vector<Vertex> vertices;
-   std::vector<GLuint> indices;
-   std::vector<Texture> textures;
+   GLuint getVertexArray() const { return VAO; }
+   GLuint getVertexBuffer() const { return VBO; }
+   GLuint getIndexBuffer() const { return EBO; }
+
+   GLsizei vertexCount;
+   GLsizei indexCount;
+
+   // Index of the MaterialRecord the shaders read, see MaterialSystem
+   GLuint material;
+
+   // Index ranges of every level, lod is the one drawn without instances,
+   // see LodSelector
+   std::vector<MeshLod> lods;
+   size_t lod = 0;
+
+   // Drawn by Model::Draw, see Model::cull
+   bool visible = true;
+
+   // Object space bounds, packed positions are quantized inside of them
+   VertexFormat format;
+   MeshBounds bounds;
 
  private:
-   void setup();
+   void setup(const MeshView &view);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,98 @@
+//===-- mesh_cache.h - MeshCache class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the MeshCache class, which is
+/// responsible for reading and writing the precompiled .3dvcache files that
+/// let models skip Assimp after their first import
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+// C++ Libraries
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Project Libraries
+#include "mapped_file.h"
+#include "mesh.h"
+
+/// Bump whenever the file layout, the Vertex structure or the import
+/// processing changes. 2: meshes are stored optimized, 3: levels of detail,
+/// 4: bounds
+constexpr uint32_t meshCacheVersion = 4;
+
+/// File layout, all offsets are in bytes from the start of the file:
+///
+/// | Header | MeshRecord[] | order[] | TextureRecord[] | MeshLod[] | strings |
+/// | data |
+///
+/// Vertex and index arrays in the data section are 16 byte aligned so that
+/// they can be passed to glBufferData straight out of the mapping.
+struct MeshCacheHeader {
+   char magic[4];
+   uint32_t version;
+   uint64_t sourceHash;
+   uint32_t importFlags;
+   uint32_t vertexSize;
+   uint32_t meshCount;
+   uint32_t orderCount;
+   uint32_t textureCount;
+   uint32_t lodCount;
+   uint32_t stringsSize;
+   uint32_t padding;
+};
+
+struct MeshCacheRecord {
+   uint64_t vertexOffset;
+   uint64_t vertexCount;
+   uint64_t indexOffset;
+   uint64_t indexCount;
+   uint32_t firstTexture;
+   uint32_t textureCount;
+   uint32_t firstLod;
+   uint32_t lodCount;
+   MeshBounds bounds;
+};
+
+struct MeshCacheTexture {
+   uint32_t typeOffset;
+   uint32_t typeLength;
+   uint32_t pathOffset;
+   uint32_t pathLength;
+};
+
+class MeshCache {
+   MappedFile file;
+   std::vector<MeshView> views;
+   std::vector<uint32_t> drawOrder;
+
+ public:
+   /// Maps the cache next to sourcePath, fails if it is missing, corrupt or
+   /// was written for another source file or other import flags
+   bool open(const std::string &sourcePath, uint32_t importFlags);
+
+   /// Views point into the mapping and stay valid while the cache is open
+   const std::vector<MeshView> &meshes() const { return views; }
+   const std::vector<uint32_t> &order() const { return drawOrder; }
+
+   static bool write(const std::string &sourcePath, uint32_t importFlags,
+                     const std::vector<MeshData> &meshes,
+                     const std::vector<uint32_t> &order);
+
+   static std::string cachePath(const std::string &sourcePath) {
+      return sourcePath + ".3dvcache";
+   }
+
+ private:
+   static bool hashSource(const std::string &sourcePath, uint64_t &hash);
+};
+
+#endif
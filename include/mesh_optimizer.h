@@ -0,0 +1,61 @@
+//===-- mesh_optimizer.h - Mesh optimization passes -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the import time mesh optimization
+/// passes, which reorder triangles and vertices for the post transform vertex
+/// cache, overdraw and vertex fetch
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+// Graphics Libraries
+#include <glad/glad.h>
+
+// C++ Libraries
+#include <cstddef>
+#include <vector>
+
+// Project Libraries
+#include "mesh.h"
+
+/// Results of a FIFO post transform cache simulation
+struct VertexCacheStats {
+   /// Average cache miss ratio, transformed vertices per triangle (0.5 - 3)
+   float acmr = 0.0f;
+   /// Average transform to vertex ratio, transformed vertices per vertex (1+)
+   float atvr = 0.0f;
+};
+
+struct MeshOptimizationReport {
+   VertexCacheStats before;
+   VertexCacheStats after;
+};
+
+VertexCacheStats analyzeVertexCache(const std::vector<GLuint> &indices,
+                                    size_t vertexCount, size_t cacheSize = 16);
+
+/// Reorders triangles for the post transform cache (Forsyth's algorithm)
+void optimizeVertexCache(std::vector<GLuint> &indices, size_t vertexCount);
+
+/// Splits the triangle order into clusters and sorts them so that outward
+/// facing clusters are drawn first, accepting an ACMR up to threshold times
+/// the incoming one
+void optimizeOverdraw(std::vector<GLuint> &indices,
+                      const std::vector<Vertex> &vertices,
+                      float threshold = 1.05f);
+
+/// Reorders vertices by first use and drops unreferenced ones
+void optimizeVertexFetch(std::vector<Vertex> &vertices,
+                         std::vector<GLuint> &indices);
+
+/// Runs all passes on a mesh, safe to call from worker threads
+MeshOptimizationReport optimizeMesh(MeshData &data, bool overdraw = true);
+
+#endif
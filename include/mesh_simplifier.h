@@ -0,0 +1,47 @@
+//===-- mesh_simplifier.h - Mesh simplification -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the import time mesh simplifier,
+/// which builds the level of detail chain of a mesh with quadric error metric
+/// edge collapses
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+// Graphics Libraries
+#include <glad/glad.h>
+
+// C++ Libraries
+#include <cstddef>
+#include <vector>
+
+// Project Libraries
+#include "mesh.h"
+
+/// Levels including the full resolution one
+constexpr size_t maxLodLevels = 5;
+
+/// Meshes and levels below this many triangles are not simplified further
+constexpr size_t minLodTriangles = 64;
+
+/// Collapses edges until at most targetIndexCount indices are left or no
+/// more edges can be collapsed. Vertices are never moved, the result indexes
+/// the same vertex array. Vertices on attribute seams stay in place and open
+/// borders only collapse along themselves. error receives the largest object
+/// space deviation introduced
+std::vector<GLuint> simplifyMesh(const std::vector<Vertex> &vertices,
+                                 const std::vector<GLuint> &indices,
+                                 size_t targetIndexCount, float &error);
+
+/// Appends levels of half the triangles of the previous one to the index
+/// buffer and fills data.lods, safe to call from worker threads
+void generateLods(MeshData &data, size_t levelCount = maxLodLevels);
+
+#endif
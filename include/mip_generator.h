@@ -0,0 +1,58 @@
+//===-- mip_generator.h - Mip chain generator declarations -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the mip chain generator, which is
+/// responsible for filtering the levels of a map on the CPU, in linear light
+/// for colors and renormalized for normal maps
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+// C++ Libraries
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+/// What a map holds. Colors are sRGB encoded and filtered in linear light,
+/// linear maps such as specular masks are filtered as stored. Normal maps
+/// keep two channels and stay normalized along their mip chain
+enum class TextureKind { Color, Linear, Normal };
+
+struct ImageLevel {
+   int width, height;
+   size_t offset, size;
+};
+
+/// RGBA8 levels down to 1x1, largest first and tightly packed
+struct MipChain {
+   std::vector<ImageLevel> levels;
+   std::vector<uint8_t> data;
+
+   bool empty() const { return levels.empty(); }
+};
+
+/// Sizes and offsets of the RGBA8 levels of an image, offsets from 0
+std::vector<ImageLevel> mipChainLevels(int width, int height);
+
+/// Filters every level from the one above with a Kaiser windowed sinc.
+/// Texels beyond the edges wrap, as the maps repeat. Rows of a level are
+/// split across the pool, if any, the calling thread works along
+MipChain generateMipChain(const uint8_t *rgba, int width, int height,
+                          TextureKind kind, ThreadPool *pool = nullptr);
+
+/// Same, but writes the levels of mipChainLevels to levels. Only writes,
+/// so levels may be write combined memory such as a mapped buffer
+void generateMipChainInto(const uint8_t *rgba, int width, int height,
+                          TextureKind kind, uint8_t *levels,
+                          ThreadPool *pool = nullptr);
+
+#endif
@@ -19,39 +19,109 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
-#include "stb_image.h"
-
 // C++ Libraries
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <future>
 #include <string>
 #include <vector>
 
 // Project Libraries
+#include "bvh.h"
+#include "frustum.h"
+#include "gl_state.h"
+#include "lod_selector.h"
+#include "material_system.h"
 #include "mesh.h"
+#include "mesh_cache.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "profiler.h"
+#include "render_queue.h"
 #include "shader_pipeline.h"
 #include "debug.h"
+#include "texture_cache.h"
+#include "thread_pool.h"
+
+/// Assimp post processing of every import, mesh caches are only valid for
+/// these flags
+constexpr uint32_t modelImportFlags =
+    aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs |
+    aiProcess_CalcTangentSpace;
+
+/// Called on the loading (GL) thread while an import is in flight, e.g. to
+/// keep polling window events
+using LoadProgress = std::function<void(size_t uploaded, size_t total)>;
 
 class Model {
-   std::vector<Texture> textures_loaded;
    std::vector<Mesh> meshes;
    std::string directory;
-   bool gammaCorrection;
+   VertexFormat vertexFormat;
+
+   // Materials of all meshes, their maps are shared with other models
+   MaterialSystem materials;
+
+   // Mesh bounds, the culling loop runs on the leaves the hierarchy reaches
+   Bvh bvh;
+   CullingBounds cullingBounds;
+   std::vector<uint8_t> visibility;
 
  public:
-   Model(std::string path, bool gamma = false);
-   void Draw(ShaderPipeline &shaderPipeline);
+   /// With gamma the diffuse maps are sampled as sRGB, the pipelines drawing
+   /// the model need gammaCorrectionDefine
+   Model(std::string path, ThreadPool &pool, TextureCache &textureCache,
+         GlState &glState, bool gamma = false,
+         VertexFormat format = VertexFormat::Full,
+         LoadProgress progress = nullptr);
+   /// Queues a draw of every visible mesh, ordered by the queue
+   void enqueue(RenderQueue &queue, ShaderPipeline &shaderPipeline,
+                const glm::mat4 &model, const glm::vec3 &viewPos) const;
+
+   /// Queues the copies placed by instances, stored in the same order in
+   /// the bound InstanceBuffer and sorted nearest first. Every mesh skips
+   /// the copies it is culled in and picks its level per copy, each run of
+   /// copies drawing the same level is one instanced draw
+   void enqueueInstances(RenderQueue &queue, ShaderPipeline &shaderPipeline,
+                         const LodSelector &selector,
+                         const std::vector<glm::mat4> &instances,
+                         const glm::mat4 &viewProjection,
+                         const glm::vec3 &viewPos) const;
+
+   /// Marks the meshes outside of the view volume invisible, returns how many
+   /// are visible
+   size_t cull(const glm::mat4 &viewProjection, const glm::mat4 &model);
+
+   /// Nearest mesh whose bounds a world space ray enters, see Camera::getRay
+   bool pick(const glm::vec3 &origin, const glm::vec3 &direction,
+             const glm::mat4 &model, size_t &mesh, float &distance) const;
+
+   /// Picks the level of detail every mesh is drawn with
+   void selectLods(const LodSelector &selector, const glm::mat4 &model,
+                   const glm::vec3 &viewPos);
+
+   /// Requests the map levels of every visible mesh from its size on
+   /// screen, assuming its texture coordinates cover the maps once
+   void requestTextures(const LodSelector &selector, const glm::mat4 &model,
+                        const glm::vec3 &viewPos) const;
+
+   const std::vector<Mesh> &getMeshes() const { return meshes; }
+   const MaterialSystem &getMaterials() const { return materials; }
+   Aabb getBounds() const;
+   VertexFormat getVertexFormat() const { return vertexFormat; }
 
- private:
    /// --- Model Processing ---
-   void loadModel(std::string path);
-   void processNode(aiNode *node, const aiScene *scene);
-   Mesh processMesh(aiMesh *mesh, const aiScene *scene);
-
-   /// --- Texture Handling ---
-   std::vector<Texture> loadMaterialTextures(aiMaterial *mat,
-                                             aiTextureType type,
-                                             std::string typeName);
-   GLuint TextureFromFile(const char *path, const std::string &directory,
-                          bool gamma = false);
+   /// Converts an aiMesh, touches no GL state and may run on any thread
+   static MeshData processMesh(const aiMesh *mesh, const aiScene *scene);
+
+ private:
+   void loadModel(std::string path, ThreadPool &pool, LoadProgress &progress);
+   void processNode(aiNode *node, std::vector<uint32_t> &order);
+   static void processMaterialTextures(const aiMaterial *mat,
+                                       aiTextureType type,
+                                       std::string typeName,
+                                       std::vector<TextureRef> &textures);
 };
 
 #endif
\ No newline at end of file
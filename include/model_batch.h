@@ -0,0 +1,106 @@
+//===-- model_batch.h - ModelBatch class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the ModelBatch class, which is
+/// responsible for packing all meshes of a model into shared buffers and
+/// drawing them with multi draw indirect
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef MODEL_BATCH_H
+#define MODEL_BATCH_H
+
+// Graphics Libraries
+#include <glad/glad.h>
+
+// C++ Libraries
+#include <cstdint>
+#include <vector>
+
+// Project Libraries
+#include "gl_state.h"
+#include "material_system.h"
+#include "mesh.h"
+#include "model.h"
+
+/// Layout mandated by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+   GLuint count;
+   GLuint instanceCount;
+   GLuint firstIndex;
+   GLint baseVertex;
+   GLuint baseInstance;
+};
+
+/// Per draw dequantization bounds of packed positions, std430 DrawBounds
+struct DrawBounds {
+   glm::vec4 boundsMin;
+   glm::vec4 boundsExtent;
+};
+
+/// Binding points of the DrawMaterials (material index of every draw) and
+/// DrawBounds storage blocks
+constexpr GLuint drawMaterialBinding = 0;
+constexpr GLuint drawBoundsBinding = 1;
+
+class ModelBatch {
+   GLuint VAO, VBO, EBO;
+   VertexFormat format;
+
+   // Draw i reads instance attribute i through its base instance
+   GLuint drawIDBuffer;
+   GLuint indirectBuffer;
+   GLuint materialBuffer;
+   GLuint boundsBuffer;
+
+   /// Consecutive commands sampling the same texture arrays, one multi draw
+   /// each
+   struct DrawGroup {
+      size_t firstCommand = 0;
+      GLsizei commandCount = 0;
+      MaterialArrays arrays;
+   };
+   std::vector<DrawGroup> groups;
+   std::vector<DrawElementsIndirectCommand> commands;
+
+   /// Mesh of each draw and where its index buffer starts, levels of detail
+   /// are ranges inside of it. Indexed by the base instance of a command,
+   /// commands are reordered as the arrays of their materials change
+   struct DrawSource {
+      size_t mesh;
+      GLuint firstIndex;
+      GLuint material;
+   };
+   std::vector<DrawSource> sources;
+
+   const MaterialSystem &materials;
+   uint64_t materialGeneration;
+   GlState &glState;
+
+ public:
+   ModelBatch(const Model &model, GlState &glState);
+   ~ModelBatch();
+
+   ModelBatch(const ModelBatch &) = delete;
+   ModelBatch &operator=(const ModelBatch &) = delete;
+
+   /// Points every draw at the level selected by Model::selectLods and
+   /// skips the meshes culled by Model::cull. Regroups the draws once maps
+   /// became resident
+   void updateDraws(const Model &model);
+
+   void Draw();
+
+   size_t drawCount() const { return commands.size(); }
+
+ private:
+   void setup();
+   void groupDraws();
+};
+
+#endif
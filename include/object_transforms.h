@@ -0,0 +1,41 @@
+//===-- object_transforms.h - Object transform definitions -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the ObjectTransforms structure and
+/// the functions computing it, which are responsible for the per object and
+/// per instance matrices so that the vertex shaders do no matrix inversion
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef OBJECT_TRANSFORMS_H
+#define OBJECT_TRANSFORMS_H
+
+// Graphics Libraries
+#include <glm/glm.hpp>
+
+// C++ Libraries
+#include <cstddef>
+
+/// Same layout in std140 and std430, 176 bytes. The normal matrix is a mat3
+/// in the shaders, its columns take a vec4 slot each
+struct ObjectTransforms {
+   glm::mat4 model;
+   glm::mat4 modelViewProjection;
+   glm::mat3x4 normalMatrix;
+};
+
+ObjectTransforms computeObjectTransforms(const glm::mat4 &model,
+                                         const glm::mat4 &viewProjection);
+
+/// Writes the transforms of count models to transforms, e.g. straight into
+/// a mapped buffer. Uses SSE2 when available
+void computeObjectTransforms(const glm::mat4 *models, size_t count,
+                             const glm::mat4 &viewProjection,
+                             ObjectTransforms *transforms);
+
+#endif
@@ -0,0 +1,149 @@
+//===-- profiler.h - Profiler class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the Profiler class, which is
+/// responsible for collecting CPU scope and GPU timer query durations,
+/// aggregating them per scope and exporting them as a Chrome trace
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Graphics Libraries
+#include <glad/glad.h>
+
+// C++ Libraries
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Frames a timer query may take before its result is read, results older
+/// than this are ready without stalling the pipeline
+constexpr size_t profilerQueryFrames = 4;
+
+struct ProfileStatistics {
+   size_t count = 0;
+   double min = 0.0, avg = 0.0, p99 = 0.0; // Milliseconds
+};
+
+/// Complete event of the trace, times in microseconds since the profiler
+/// was created
+struct ProfileEvent {
+   const char *name;
+   bool gpu;
+   int thread;
+   double start, duration;
+};
+
+class Profiler {
+   std::atomic<bool> enabled{false};
+   const std::chrono::steady_clock::time_point epoch =
+       std::chrono::steady_clock::now();
+
+   // CPU scopes end on any thread
+   mutable std::mutex mutex;
+   std::vector<ProfileEvent> events;
+   std::map<std::thread::id, int> threads;
+
+   // GPU scopes are GL_TIME_ELAPSED queries, which cannot nest. Queries of a
+   // frame are read profilerQueryFrames frames later
+   struct PendingQuery {
+      const char *name;
+      GLuint query;
+      double start;
+   };
+   std::vector<PendingQuery> pending[profilerQueryFrames];
+   std::vector<GLuint> freeQueries;
+   size_t frame = 0;
+   bool gpuScopeOpen = false;
+
+ public:
+   void setEnabled(bool enabled) { this->enabled = enabled; }
+   bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+   /// Microseconds since the profiler was created
+   double now() const;
+
+   void addCpuEvent(const char *name, double start, double duration);
+
+   /// --- GPU Scopes ---
+   /// Starts the next frame of the query ring, collecting the results of the
+   /// frame that used its queries before. Must be called on the GL thread
+   void beginFrame();
+   bool beginGpuScope(const char *name);
+   void endGpuScope();
+
+   /// Waits for all queries in flight and releases them, call before the
+   /// context goes away
+   void finish();
+
+   /// --- Results ---
+   ProfileStatistics getStatistics(const std::string &name, bool gpu) const;
+
+   /// Logs the statistics of every scope
+   void report() const;
+
+   /// Chrome trace event JSON, open with chrome://tracing or Perfetto
+   bool writeTrace(const std::string &path) const;
+
+ private:
+   void collect(std::vector<PendingQuery> &queries, bool wait);
+};
+
+/// The profiler shared by all scopes, disabled until enabled
+Profiler &getProfiler();
+
+/// Records the time until the end of the enclosing block. name has to
+/// outlive the profiler, e.g. a string literal
+class ProfileScope {
+   const char *name;
+   double start = -1.0;
+
+ public:
+   explicit ProfileScope(const char *name) : name(name) {
+      Profiler &profiler = getProfiler();
+      if (profiler.isEnabled())
+         start = profiler.now();
+   }
+   ~ProfileScope() {
+      if (start >= 0.0) {
+         Profiler &profiler = getProfiler();
+         profiler.addCpuEvent(name, start, profiler.now() - start);
+      }
+   }
+
+   ProfileScope(const ProfileScope &) = delete;
+   ProfileScope &operator=(const ProfileScope &) = delete;
+};
+
+/// Measures the GPU time of the commands issued in the enclosing block. Has
+/// to be used on the GL thread and must not nest
+class GpuProfileScope {
+   bool active = false;
+
+ public:
+   explicit GpuProfileScope(const char *name) {
+      Profiler &profiler = getProfiler();
+      if (profiler.isEnabled())
+         active = profiler.beginGpuScope(name);
+   }
+   ~GpuProfileScope() {
+      if (active)
+         getProfiler().endGpuScope();
+   }
+
+   GpuProfileScope(const GpuProfileScope &) = delete;
+   GpuProfileScope &operator=(const GpuProfileScope &) = delete;
+};
+
+#endif
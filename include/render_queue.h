@@ -0,0 +1,100 @@
+//===-- render_queue.h - RenderQueue class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the RenderQueue class, which is
+/// responsible for collecting the draws of a frame, ordering them by 64-bit
+/// sort keys and submitting them without redundant state changes
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+// Graphics Libraries
+#include <glad/glad.h>
+
+// C++ Libraries
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Project Libraries
+#include "gl_state.h"
+#include "material_system.h"
+#include "mesh.h"
+#include "shader_pipeline.h"
+
+/// One draw of a frame. depth is the distance to the viewer, transparent
+/// draws are blended back to front after all opaque ones
+struct DrawPacket {
+   ShaderPipeline *pipeline;
+   const MaterialSystem *materials;
+   GLuint material;
+   const Mesh *mesh;
+   size_t lod = 0;
+
+   // Instances firstInstance to firstInstance + instanceCount of the bound
+   // InstanceBuffer, the pipeline needs instancedDefine for more than one
+   GLsizei instanceCount = 1;
+   GLint firstInstance = 0;
+   float depth = 0.0f;
+   bool transparent = false;
+};
+
+/// Binds of one kind of state and the ones skipped as redundant
+struct StateCounter {
+   size_t changes = 0;
+   size_t avoided = 0;
+};
+
+struct RenderQueueStats {
+   size_t packets = 0;
+   StateCounter pipelines;
+   StateCounter textures;
+   StateCounter materials;
+   StateCounter vertexArrays;
+};
+
+class RenderQueue {
+   std::vector<DrawPacket> packets;
+   std::vector<uint64_t> keys, keyScratch;
+   std::vector<uint32_t> order, orderScratch;
+
+   // Small ids of the pipelines and texture array sets of this frame, their
+   // order is the order of the sort
+   std::vector<const ShaderPipeline *> pipelines;
+   std::vector<MaterialArrays> arraySets;
+   std::vector<uint32_t> packetPipelines, packetArrays;
+
+   RenderQueueStats stats;
+   GlState &glState;
+
+ public:
+   explicit RenderQueue(GlState &glState) : glState(glState) {}
+
+   /// Drops the packets of the last frame, keeps the statistics
+   void clear();
+   void push(const DrawPacket &packet);
+
+   /// Sorts by key, then draws. Opaque draws are grouped by pipeline,
+   /// texture arrays, material and vertex array, nearest first within a
+   /// group. Needs the frame's object block bound
+   void submit();
+
+   size_t size() const { return packets.size(); }
+   const RenderQueueStats &getStats() const { return stats; }
+
+   /// Logs the state changes made and avoided since the start
+   void report() const;
+
+ private:
+   uint64_t sortKey(uint32_t packet) const;
+   void sort();
+};
+
+#endif
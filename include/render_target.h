@@ -0,0 +1,49 @@
+//===-- render_target.h - RenderTarget class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the RenderTarget class, which is
+/// responsible for an offscreen framebuffer with color and depth attachments
+/// that frames can be rendered into and read back from
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+// Graphics Libraries
+#include <glad/glad.h>
+
+// C++ Libraries
+#include <cstdint>
+#include <vector>
+
+class RenderTarget {
+   GLuint FBO;
+   GLuint colorBuffer, depthBuffer;
+   GLsizei width, height;
+
+ public:
+   RenderTarget(GLsizei width, GLsizei height);
+   ~RenderTarget();
+
+   RenderTarget(const RenderTarget &) = delete;
+   RenderTarget &operator=(const RenderTarget &) = delete;
+
+   bool isComplete() const;
+
+   /// Binds the framebuffer for drawing and sets the viewport to cover it
+   void bind() const;
+
+   /// Reads the color attachment as tightly packed RGB rows, top row first
+   void readPixels(std::vector<uint8_t> &pixels) const;
+
+   GLsizei getWidth() const { return width; }
+   GLsizei getHeight() const { return height; }
+};
+
+#endif
@@ -19,37 +19,87 @@
 #include <glad/glad.h>
 
 // C++ Libraries
+#include <cstdint>
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <vector>
 
 // Project Libraries
 #include "debug.h"
+#include "gl_state.h"
 
 struct ShaderPaths {
    std::string vertexPath;
    std::string fragmentPath;
+
+   /// Preprocessor symbols defined for both stages, e.g. "PACKED_VERTICES"
+   std::vector<std::string> defines;
+};
+
+/// --- Uniform Reflection ---
+/// Uniforms are identified by the FNV-1a hash of their name so that lookups
+/// can be resolved at compile time or once at load, never per frame.
+using UniformID = uint32_t;
+
+constexpr UniformID uniformID(const char *name, UniformID hash = 2166136261u) {
+   return *name ? uniformID(name + 1, (hash ^ static_cast<uint8_t>(*name)) *
+                                          16777619u)
+                : hash;
+}
+
+/// Uniform location handle, -1 for uniforms that are inactive or missing
+using UniformHandle = GLint;
+
+struct UniformInfo {
+   UniformID id = 0;
+   UniformHandle location = -1;
+   GLenum type = GL_NONE;
+   GLint size = 0;
 };
 
 class ShaderPipeline {
    GLuint shaderProgram;
+   GlState &glState;
 
    // Shaders
    GLuint vertexShader;
    GLuint fragmentShader;
 
+   // Open addressed table of active uniforms, size is a power of two
+   std::vector<UniformInfo> uniforms;
+
  public:
-   ShaderPipeline(ShaderPaths paths);
+   ShaderPipeline(ShaderPaths paths, GlState &glState);
    ~ShaderPipeline();
 
-   void use() { glUseProgram(shaderProgram); }
-   void setVec3(const std::string &name, const GLfloat *value) const;
-   void setMat4(const std::string &name, const GLfloat *value) const;
-   void setInt(const std::string &name, const GLint value) const;
+   void use() { glState.useProgram(shaderProgram); }
+
+   /// --- Uniform Handles ---
+   UniformHandle getUniform(const UniformID id) const;
+   UniformHandle getUniform(const std::string &name) const {
+      return getUniform(uniformID(name.c_str()));
+   }
+
+   void setVec3(const UniformHandle handle, const GLfloat *value) const;
+   void setMat4(const UniformHandle handle, const GLfloat *value) const;
+   void setInt(const UniformHandle handle, const GLint value) const;
+
+   void setVec3(const std::string &name, const GLfloat *value) const {
+      setVec3(getUniform(name), value);
+   }
+   void setMat4(const std::string &name, const GLfloat *value) const {
+      setMat4(getUniform(name), value);
+   }
+   void setInt(const std::string &name, const GLint value) const {
+      setInt(getUniform(name), value);
+   }
 
  private:
-   GLuint genShader(GLenum type, std::string file);
+   GLuint genShader(GLenum type, std::string file,
+                    const std::vector<std::string> &defines);
    GLuint genProgram();
+   void reflectUniforms();
 };
 
 #endif
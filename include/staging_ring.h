@@ -0,0 +1,89 @@
+//===-- staging_ring.h - StagingRing class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the StagingRing class, which is
+/// responsible for a persistently mapped upload buffer that worker threads
+/// write decoded images into, so that the GL thread uploads them without
+/// copying
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef STAGING_RING_H
+#define STAGING_RING_H
+
+// Graphics Libraries
+#include <glad/glad.h>
+
+// C++ Libraries
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+// Project Libraries
+#include "gl_state.h"
+
+/// Bytes of a ring, see StagingRing::allocate
+struct StagingRegion {
+   size_t offset = 0;
+   size_t size = 0;
+   uint8_t *data = nullptr;
+
+   explicit operator bool() const { return data != nullptr; }
+};
+
+class StagingRing {
+   GLuint buffer = 0;
+   uint8_t *mapping = nullptr;
+   size_t capacity;
+
+   /// Regions in the order they were handed out. Regions are reused once
+   /// all before them were retired and the GPU passed the fence of their
+   /// uploads
+   struct Region {
+      size_t offset, size;
+      bool retired = false;
+      std::shared_ptr<__GLsync> fence;
+   };
+   std::deque<Region> regions;
+   size_t head = 0;
+
+   // Retired since the last fence
+   size_t unfenced = 0;
+
+   // Workers allocate while the GL thread retires and reclaims
+   std::mutex mutex;
+
+   GlState &glState;
+
+ public:
+   /// Needs a current OpenGL 4.5 context, as does every call but allocate
+   StagingRing(size_t capacity, GlState &glState);
+   ~StagingRing();
+
+   StagingRing(const StagingRing &) = delete;
+   StagingRing &operator=(const StagingRing &) = delete;
+
+   /// Hands out size contiguous bytes, callable from any thread. Fails
+   /// instead of waiting for the GPU when the ring is full
+   bool allocate(size_t size, StagingRegion &region);
+
+   /// Marks the region as read by the upload commands issued so far
+   void retire(const StagingRegion &region);
+
+   /// Fences the regions retired since the last call
+   void fence();
+
+   /// Frees the regions whose uploads the GPU has finished
+   void reclaim();
+
+   GLuint getBuffer() const { return buffer; }
+};
+
+#endif
@@ -0,0 +1,214 @@
+//===-- texture_cache.h - TextureCache class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the TextureCache class, which is
+/// responsible for sharing maps between all models, keyed by canonical path
+/// and content hash, packing them into texture arrays grouped by size and
+/// format, and streaming their finer levels in and out within a budget
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+// Graphics Libraries
+#include <glad/glad.h>
+
+// C++ Libraries
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Project Libraries
+#include "gl_state.h"
+#include "texture_loader.h"
+
+/// Reference counted map of the cache, see TextureCache::acquire
+using TextureHandle = GLuint;
+constexpr TextureHandle noTexture = ~0u;
+
+/// Called on the GL thread once a map became resident. Arrays may have been
+/// reallocated on the way, so the arrays of every handle can have changed
+using TextureListener = std::function<void(TextureHandle texture)>;
+
+struct TextureCacheStats {
+   size_t requests = 0;
+   // Requests of a path that was already cached
+   size_t pathHits = 0;
+   // Decoded files whose contents were already resident under another path
+   size_t contentHits = 0;
+   size_t uploads = 0;
+   // Maps moved to finer or coarser levels by stream()
+   size_t streamedIn = 0;
+   size_t streamedOut = 0;
+};
+
+class TextureCache {
+   /// Array holding every image of one size and format, RGBA8 or blocks,
+   /// with a full mip chain. Layers of released images are reused before the
+   /// array grows, arrays left empty free their storage
+   struct TextureArray {
+      GLuint texture = 0;
+      GLenum format;
+      GLsizei width, height, levels;
+      GLsizei layers = 0;
+      GLsizei capacity = 0;
+      std::vector<GLuint> freeLayers;
+   };
+   std::vector<TextureArray> arrays;
+   std::map<std::tuple<int, int, GLenum>, size_t> arrayOfSize;
+
+   static constexpr GLsizei noLevel = -1;
+
+   /// Layer holding one decoded image, shared by all paths whose files have
+   /// the same contents. The layer holds the levels from residentLevel on,
+   /// its array is sized for the first of them
+   struct Image {
+      uint64_t hash;
+      size_t array;
+      GLuint layer;
+      size_t references = 0;
+
+      // Level 0 and the full chain, as the file decodes
+      GLsizei width, height, levels;
+      GLenum format;
+      GLsizei residentLevel = 0;
+
+      // Finest level requested this frame, the one being loaded and the
+      // frame of the last request
+      GLsizei wantedLevel = 0;
+      GLsizei streamingLevel = noLevel;
+      uint64_t lastRequested = 0;
+
+      // Loads of an image compare this, its slot may have been reused
+      uint64_t serial = 0;
+
+      // A reload failed, the image keeps its levels until the budget
+      // changes instead of decoding the file again every frame
+      bool streamFailed = false;
+      std::string path;
+      TextureKind kind = TextureKind::Color;
+      bool srgb = false;
+   };
+   static constexpr GLuint noImage = ~0u;
+   std::vector<Image> images;
+   std::vector<GLuint> freeImages;
+   std::unordered_map<uint64_t, GLuint> imageOfHash;
+
+   /// A canonical path and its references. Released entries stay until
+   /// their pending upload arrived
+   struct Entry {
+      std::string path;
+      size_t references = 0;
+      GLuint image = noImage;
+      TextureKind kind = TextureKind::Color;
+      bool srgb = false;
+      bool loading = false;
+   };
+   std::vector<Entry> entries;
+   std::vector<TextureHandle> freeEntries;
+   std::unordered_map<std::string, TextureHandle> entryOfPath;
+
+   std::vector<std::pair<size_t, TextureListener>> listeners;
+   size_t nextListener = 0;
+
+   // Cap of the resident levels, see setBudget. Reloads in flight reserve
+   // their bytes until they arrived
+   size_t budget = 0;
+   size_t residentBytes = 0;
+   size_t streamingBytes = 0;
+   size_t streams = 0;
+   uint64_t frame = 1;
+   uint64_t nextSerial = 0;
+
+   TextureCacheStats stats;
+   TextureLoader &textureLoader;
+   GlState &glState;
+
+ public:
+   /// Maps are decoded by the loader, which must not upload them after the
+   /// cache is gone
+   TextureCache(TextureLoader &textureLoader, GlState &glState);
+   ~TextureCache();
+
+   TextureCache(const TextureCache &) = delete;
+   TextureCache &operator=(const TextureCache &) = delete;
+
+   /// Adds a reference to the map of this file, decoding it on first use.
+   /// The kind of the first request picks the compression, its srgb whether
+   /// sampling decodes the colors to linear. Every acquire needs a release
+   TextureHandle acquire(const std::string &path,
+                         TextureKind kind = TextureKind::Color,
+                         bool srgb = false);
+   void release(TextureHandle texture);
+
+   /// Array and layer of a resident map, the array is 0 until then
+   GLuint getArray(TextureHandle texture) const;
+   GLuint getLayer(TextureHandle texture) const;
+
+   /// Caps the bytes of the resident levels of all maps. Maps placed from
+   /// then on start with the levels of at most streamStartSize texels, the
+   /// finer ones are streamed in on request. 0 keeps every level resident.
+   /// Maps that failed to stream in are tried again
+   void setBudget(size_t bytes);
+
+   /// Asks for the level that still has as many texels across as the map
+   /// covers pixels on screen, for the next stream()
+   void request(TextureHandle texture, float pixels);
+
+   /// Reloads the finest requested levels that fit into the budget. Maps
+   /// holding finer levels than requested drop them to make room, least
+   /// recently requested first. Call once per frame after the requests
+   void stream();
+
+   /// Returns an id for removeListener
+   size_t addListener(TextureListener listener);
+   void removeListener(size_t id);
+
+   const TextureCacheStats &getStats() const { return stats; }
+
+   /// Logs the hits and uploads since the start
+   void report() const;
+
+   /// Side of the levels maps start with while streaming
+   static constexpr int streamStartSize = 64;
+
+   /// Reloads in flight at once
+   static constexpr size_t maxStreams = 4;
+
+ private:
+   void place(TextureHandle texture, const DecodedImage &decoded);
+   GLuint allocateImage(const DecodedImage &decoded, TextureKind kind,
+                        bool srgb);
+   void releaseImage(GLuint image);
+   void dropEntry(TextureHandle texture);
+
+   /// --- Streaming ---
+   void streamed(GLuint image, uint64_t serial, size_t reserved,
+                 const DecodedImage &decoded);
+   bool evict(size_t needed, GLuint keep);
+   void relocate(GLuint image, GLsizei level);
+   void notify(GLuint image);
+   GLsizei startLevel(GLsizei width, GLsizei height, GLsizei levels) const;
+   static size_t imageBytes(const Image &image, GLsizei level);
+
+   /// --- Layers ---
+   void placeLayer(Image &image, GLsizei level);
+   void uploadLayer(const Image &image, const DecodedImage &decoded);
+   void freeLayer(size_t array, GLuint layer);
+   size_t findArray(int width, int height, GLenum format);
+   void grow(TextureArray &array);
+};
+
+#endif
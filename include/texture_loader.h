@@ -0,0 +1,142 @@
+//===-- texture_loader.h - TextureLoader class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the TextureLoader class, which is
+/// responsible for decoding or block compressing images on worker threads
+/// and streaming them into GL textures through pixel buffer objects
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+// Graphics Libraries
+#include <glad/glad.h>
+
+#include "stb_image.h"
+
+// C++ Libraries
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Project Libraries
+#include "compressed_texture.h"
+#include "debug.h"
+#include "gl_state.h"
+#include "lockfree_queue.h"
+#include "mapped_file.h"
+#include "staging_ring.h"
+#include "thread_pool.h"
+
+struct DecodedImage;
+
+/// Called on the GL thread with an image whose pixels, mip chain or
+/// compressed levels were staged in the bound GL_PIXEL_UNPACK_BUFFER, e.g.
+/// to copy it into an array layer instead of a texture of its own. Pixels
+/// start at offset 0, levels at their offsets. Images that failed to load
+/// come without any of them
+using ImageUpload = std::function<void(const DecodedImage &image)>;
+
+/// Image decoded by a worker, waiting for its upload on the GL thread
+struct DecodedImage {
+   GLuint texture = 0;
+   ImageUpload upload;
+   std::string path;
+   // Hash of the encoded file, equal files decode to equal pixels
+   uint64_t hash = 0;
+   int width = 0;
+   int height = 0;
+   int components = 0;
+   stbi_uc *pixels = nullptr;
+   // RGBA8 levels, or their blocks, instead of pixels, see
+   // TextureLoader::load
+   MipChain mips;
+   CompressedImage compressed;
+   // Levels the worker wrote straight into the staging ring, their data
+   // stays empty and their offsets point into the ring
+   StagingRegion staging;
+};
+
+/// Pixel transfer format of an image with this many 8-bit components
+GLenum imageFormat(int components);
+
+class TextureLoader {
+   ThreadPool &pool;
+   GlState &glState;
+   LockFreeQueue<DecodedImage> decoded;
+
+   // Images the full queue had no room for. Workers never wait for the GL
+   // thread, which may itself be waiting on the pool
+   std::deque<DecodedImage> overflow;
+   std::atomic<size_t> overflowSize{0};
+   std::mutex overflowMutex;
+
+   // Requests that were not uploaded yet
+   std::atomic<size_t> pending{0};
+
+   // Persistently mapped buffer the workers stage levels in
+   StagingRing staging;
+
+   // Upload buffer of pixels and of levels the ring had no room for,
+   // orphaned on every upload
+   GLuint PBO;
+
+   // Block compression of maps loaded with a kind, BC1/BC3 need S3TC
+   bool compression = true;
+   bool s3tc = false;
+
+ public:
+   TextureLoader(ThreadPool &pool, GlState &glState, size_t queueCapacity = 16,
+                 size_t stagingCapacity = 64 * 1024 * 1024);
+   ~TextureLoader();
+
+   /// Returns a texture that holds a 1x1 placeholder until its image was
+   /// decoded and uploaded
+   GLuint load(const std::string &filename, bool normalMap = false);
+
+   /// Decodes the image on a worker and hands it to upload, no texture is
+   /// created. The mip chain is filtered for the kind on the workers. Unless
+   /// compression is off, images whose sides are multiples of 4 are block
+   /// compressed with it. The blocks are cached next to the image and read
+   /// from there next time
+   void load(const std::string &filename, ImageUpload upload,
+             TextureKind kind = TextureKind::Color);
+
+   void setCompression(bool enabled) { compression = enabled; }
+
+   /// Uploads decoded images until byteBudget is spent, at least one image
+   /// is uploaded if any is ready. Must be called on the GL thread.
+   size_t upload(size_t byteBudget = 32 * 1024 * 1024);
+
+   bool idle() const { return pending.load() == 0; }
+
+ private:
+   void decode(GLuint texture, ImageUpload upload, std::string filename,
+               TextureKind kind, bool compress);
+   /// Next decoded image of the queue or of the overflow
+   bool pop(DecodedImage &image);
+
+   /// False if the upload buffer could not be mapped
+   bool uploadImage(const DecodedImage &image);
+
+   /// Replaces the RGBA8 pixels by their mip chain, or by its blocks, which
+   /// are written to the cache
+   void generateLevels(DecodedImage &image, TextureKind kind, bool compress);
+
+   /// Copies blocks into the staging ring if it has room, else into the
+   /// image
+   void stageBlocks(DecodedImage &image, const uint8_t *blocks);
+};
+
+#endif
@@ -0,0 +1,65 @@
+//===-- thread_pool.h - ThreadPool class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the ThreadPool class, which is
+/// responsible for running CPU side work such as model conversion on a fixed
+/// set of worker threads
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+// C++ Libraries
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+   std::vector<std::thread> workers;
+   std::queue<std::function<void()>> tasks;
+
+   std::mutex mutex;
+   std::condition_variable condition;
+   bool stopping = false;
+
+ public:
+   /// Defaults to one worker per hardware thread
+   explicit ThreadPool(size_t threadCount = 0);
+   ~ThreadPool();
+
+   ThreadPool(const ThreadPool &) = delete;
+   ThreadPool &operator=(const ThreadPool &) = delete;
+
+   size_t size() const { return workers.size(); }
+
+   /// Queues a task and returns a future holding its result
+   template <typename F> auto submit(F &&task) -> std::future<decltype(task())> {
+      using Result = decltype(task());
+      auto packaged =
+          std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+      std::future<Result> result = packaged->get_future();
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         tasks.emplace([packaged]() { (*packaged)(); });
+      }
+      condition.notify_one();
+      return result;
+   }
+
+ private:
+   void work();
+};
+
+#endif
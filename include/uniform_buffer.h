@@ -0,0 +1,100 @@
+//===-- uniform_buffer.h - UniformBuffer class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the UniformBuffer class, which is
+/// responsible for the per frame, per light and per object uniform blocks,
+/// written once per frame into a persistently mapped buffer
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+// Graphics Libraries
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// C++ Libraries
+#include <cstddef>
+
+// Project Libraries
+#include "gl_state.h"
+#include "object_transforms.h"
+
+/// Binding points of the FrameBlock, LightBlock and ObjectBlock uniform
+/// blocks
+constexpr GLuint frameBlockBinding = 0;
+constexpr GLuint lightBlockBinding = 1;
+constexpr GLuint objectBlockBinding = 2;
+
+/// Frames the CPU may write ahead of the GPU
+constexpr size_t uniformBufferRegions = 3;
+
+/// std140 layouts, vec3 members take a vec4 slot
+struct FrameBlock {
+   glm::mat4 view;
+   glm::mat4 projection;
+   glm::vec4 viewPos;
+};
+
+struct LightBlock {
+   glm::vec4 position;
+   glm::vec4 ambient;
+   glm::vec4 specular;
+   glm::vec4 color;
+};
+
+/// Model, model view projection and normal matrix of one object
+using ObjectBlock = ObjectTransforms;
+
+class UniformBuffer {
+   GLuint buffer;
+   char *mapped;
+
+   // Every block starts at a multiple of the offset alignment, a region
+   // holds the frame and light blocks followed by objectCapacity objects
+   GLsizeiptr frameSize, lightSize, objectSize;
+   GLsizeiptr regionSize;
+   size_t objectCapacity;
+
+   GLsync fences[uniformBufferRegions] = {};
+   size_t region = 0;
+
+   GlState &glState;
+
+ public:
+   UniformBuffer(size_t objectCapacity, GlState &glState);
+   ~UniformBuffer();
+
+   UniformBuffer(const UniformBuffer &) = delete;
+   UniformBuffer &operator=(const UniformBuffer &) = delete;
+
+   /// Waits until the GPU is done with the next region, call once per frame
+   /// before writing any block
+   void begin();
+
+   /// Write the block into the current region and bind it
+   void setFrame(const FrameBlock &frame);
+   void setLight(const LightBlock &light);
+
+   /// Writes the block of object index, see bindObject
+   void setObject(size_t index, const ObjectBlock &object);
+
+   /// Binds the block of object index for the following draws
+   void bindObject(size_t index) const;
+
+   /// Marks the region as in use by the draws issued since begin
+   void fence();
+
+   size_t getObjectCapacity() const { return objectCapacity; }
+
+ private:
+   GLsizeiptr regionOffset() const { return regionSize * GLsizeiptr(region); }
+};
+
+#endif
@@ -0,0 +1,66 @@
+//===-- vertex_format.h - Vertex format definitions -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the GPU vertex formats, which are
+/// either the full float Vertex or a quantized 16 byte PackedVertex, and the
+/// attribute setup shared by all vertex array objects
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+// Graphics Libraries
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// C++ Libraries
+#include <cstdint>
+#include <vector>
+
+struct Vertex {
+   glm::vec3 Position;
+   glm::vec3 Normal;
+   glm::vec2 TexCoords;
+   glm::vec3 Tangent;
+   glm::vec3 Bitangent;
+};
+
+/// Quantized vertex, 16 instead of 56 bytes:
+///  - Position: 16-bit unorm inside of the mesh bounds, w unused
+///  - Frame: octahedral normal (2x12 bits), tangent angle around the normal
+///           (7 bits) and bitangent sign (1 bit)
+///  - TexCoords: half floats
+struct PackedVertex {
+   uint16_t Position[4];
+   uint32_t Frame;
+   uint32_t TexCoords;
+};
+
+enum class VertexFormat { Full, Packed };
+
+/// Shader define selecting the decoding path of the model shaders
+constexpr const char *packedVerticesDefine = "PACKED_VERTICES";
+
+inline GLsizei vertexStride(VertexFormat format) {
+   return format == VertexFormat::Packed ? sizeof(PackedVertex)
+                                         : sizeof(Vertex);
+}
+
+/// Quantizes vertices against the bounds [boundsMin, boundsMin + extent]
+std::vector<PackedVertex> packVertices(const Vertex *vertices, size_t count,
+                                       const glm::vec3 &boundsMin,
+                                       const glm::vec3 &boundsExtent);
+
+uint32_t packTangentFrame(const glm::vec3 &normal, const glm::vec3 &tangent,
+                          const glm::vec3 &bitangent);
+
+/// Declares the attributes of format on VAO, reading from buffer binding
+void vertexAttributes(GLuint VAO, GLuint binding, VertexFormat format);
+
+#endif
@@ -0,0 +1,147 @@
+//===-- viewer.h - Viewer class definition -------*- C++ -*-===//
+//
+// Part of the 3d.view project
+// Author: BillisC
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declaration of the Viewer class, which is
+/// responsible for the scene shared by the window and the headless mode:
+/// pipelines, lamp, model and the per frame culling and draw submission
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef VIEWER_H
+#define VIEWER_H
+
+// Graphics Libraries
+#include <glm/glm.hpp>
+
+// C++ Libraries
+#include <memory>
+#include <string>
+#include <vector>
+
+// Project Libraries
+#include "bvh.h"
+#include "camera.h"
+#include "gl_state.h"
+#include "instance_buffer.h"
+#include "light_source.h"
+#include "lod_selector.h"
+#include "model.h"
+#include "model_batch.h"
+#include "render_queue.h"
+#include "shader_pipeline.h"
+#include "texture_cache.h"
+#include "texture_loader.h"
+#include "thread_pool.h"
+#include "uniform_buffer.h"
+#include "vertex_format.h"
+
+/// Command line options of both modes
+struct ViewerOptions {
+   std::string modelPath = "assets/wood/wood.obj";
+   VertexFormat vertexFormat = VertexFormat::Full;
+
+   // Starts with the multi draw indirect batch instead of per mesh draws,
+   // not with an instance grid
+   bool batch = false;
+
+   // Draws an instanceGrid x instanceGrid grid of copies of the model
+   int instanceGrid = 0;
+
+   // Block compresses the maps, see TextureLoader::load
+   bool compressTextures = true;
+
+   // Samples the diffuse maps as sRGB and lights in linear space
+   bool gammaCorrection = false;
+
+   // Bytes of map levels kept resident, finer ones stream in as the camera
+   // approaches. 0 keeps every level, see TextureCache::setBudget
+   size_t textureBudget = 0;
+
+   // Window or render target size
+   int width = 500;
+   int height = 500;
+
+   // Headless mode, renders frames along an orbit around the model. Frames
+   // listed in dumpFrames are written to dumpPath, whose one %d or %0Nd
+   // is replaced by the frame number and whose extension (.png or .ppm)
+   // picks the format
+   bool headless = false;
+   int frames = 120;
+   std::vector<int> dumpFrames;
+   std::string dumpPath = "frame_%04d.png";
+   std::string timingsPath;
+
+   // Enables the profiler, its Chrome trace is written here on exit
+   std::string profilePath;
+};
+
+class Viewer {
+   // Bindings of the context the viewer renders with, declared first so
+   // that every object deleting names through it is gone before it
+   GlState glState;
+
+   // Declared before the loader and model so that they are gone before it
+   ThreadPool workers;
+   std::unique_ptr<TextureLoader> textureLoader;
+   std::unique_ptr<TextureCache> textureCache;
+
+   std::unique_ptr<ShaderPipeline> modelPipeline, batchPipeline;
+   std::unique_ptr<ShaderPipeline> instancedPipeline, lightPipeline;
+
+   // Frame, light and the model and lamp objects
+   std::unique_ptr<UniformBuffer> uniforms;
+
+   std::unique_ptr<LightSource> lamp;
+   std::unique_ptr<Model> model;
+   std::unique_ptr<ModelBatch> batch;
+
+   // Per mesh draws of a frame, sorted to skip redundant state changes
+   RenderQueue renderQueue{glState};
+
+   // Levels of detail may deviate by up to a pixel on screen
+   LodSelector lodSelector{1.0f};
+
+   // Copies of the model, culled through a hierarchy over their world space
+   // bounds that is refit before the first frame after one of them moved
+   std::vector<glm::mat4> instanceTransforms;
+   std::vector<Aabb> instanceBounds;
+   Bvh instanceBvh;
+   bool instancesMoved = false;
+   std::vector<glm::mat4> visibleInstances;
+   std::unique_ptr<InstanceBuffer> instances;
+
+ public:
+   /// Compiles the pipelines and imports the model, calling progress between
+   /// meshes. Needs a current OpenGL 4.5 context
+   Viewer(const ViewerOptions &options, LoadProgress progress = nullptr);
+   ~Viewer();
+
+   Viewer(const Viewer &) = delete;
+   Viewer &operator=(const Viewer &) = delete;
+
+   /// Uploads decoded textures, then culls and draws the scene into the
+   /// bound framebuffer, whose viewport is width x height pixels. The batch
+   /// does not draw instances, useBatch is ignored with an instance grid
+   void renderFrame(const Camera &camera, int width, int height,
+                    bool useBatch);
+
+   /// Logs the mesh under the center of the screen
+   void pick(const Camera &camera, float aspect) const;
+
+   /// Moves a copy of the instance grid, index as in row major grid order
+   void setInstanceTransform(size_t index, const glm::mat4 &transform);
+   size_t getInstanceCount() const { return instanceTransforms.size(); }
+
+   const Model &getModel() const { return *model; }
+   TextureLoader &getTextureLoader() { return *textureLoader; }
+   const TextureCache &getTextureCache() const { return *textureCache; }
+   const RenderQueue &getRenderQueue() const { return renderQueue; }
+   const GlState &getGlState() const { return glState; }
+};
+
+#endif
@@ -0,0 +1,477 @@
+#include "block_compression.h"
+
+// C++ Libraries
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+size_t blockBytes(BlockFormat format) {
+   return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t compressedSize(BlockFormat format, int width, int height) {
+   return size_t((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+GLenum blockInternalFormat(BlockFormat format, bool srgb) {
+   switch (format) {
+   case BlockFormat::BC1:
+      return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+                  : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+   case BlockFormat::BC3:
+      return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+                  : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+   case BlockFormat::BC5:
+      return GL_COMPRESSED_RG_RGTC2;
+   case BlockFormat::BC7:
+      return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+                  : GL_COMPRESSED_RGBA_BPTC_UNORM;
+   }
+   return GL_NONE;
+}
+
+/// --- Endpoint Fitting ---
+/// Texels of a block as floats in [0, 255], RGBA
+using BlockTexels = float[16][4];
+
+/// Colors a block can reproduce, stored per channel for the SIMD search.
+/// Sizes are multiples of 4
+struct Palette {
+   alignas(16) float channels[4][16];
+   int size;
+};
+
+/// Index of the nearest palette entry of every texel, returns the summed
+/// squared error of the block
+static float nearestIndices(const BlockTexels texels, const Palette &palette,
+                            uint8_t indices[16]) {
+   float total = 0.0f;
+
+#if defined(__SSE2__)
+   // Four palette entries per step, the running minimum keeps the lowest
+   // index on ties
+   for (int t = 0; t < 16; t++) {
+      const __m128 r = _mm_set1_ps(texels[t][0]);
+      const __m128 g = _mm_set1_ps(texels[t][1]);
+      const __m128 b = _mm_set1_ps(texels[t][2]);
+      const __m128 a = _mm_set1_ps(texels[t][3]);
+
+      __m128 best = _mm_set1_ps(FLT_MAX);
+      __m128i bestIndex = _mm_setzero_si128();
+      __m128i index = _mm_set_epi32(3, 2, 1, 0);
+      for (int k = 0; k < palette.size; k += 4) {
+         const __m128 dr = _mm_sub_ps(_mm_load_ps(&palette.channels[0][k]), r);
+         const __m128 dg = _mm_sub_ps(_mm_load_ps(&palette.channels[1][k]), g);
+         const __m128 db = _mm_sub_ps(_mm_load_ps(&palette.channels[2][k]), b);
+         const __m128 da = _mm_sub_ps(_mm_load_ps(&palette.channels[3][k]), a);
+         const __m128 error =
+             _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)),
+                        _mm_add_ps(_mm_mul_ps(db, db), _mm_mul_ps(da, da)));
+
+         const __m128i less = _mm_castps_si128(_mm_cmplt_ps(error, best));
+         best = _mm_min_ps(error, best);
+         bestIndex = _mm_or_si128(_mm_and_si128(less, index),
+                                  _mm_andnot_si128(less, bestIndex));
+         index = _mm_add_epi32(index, _mm_set1_epi32(4));
+      }
+
+      alignas(16) float errors[4];
+      alignas(16) int32_t candidates[4];
+      _mm_store_ps(errors, best);
+      _mm_store_si128(reinterpret_cast<__m128i *>(candidates), bestIndex);
+      int lane = 0;
+      for (int i = 1; i < 4; i++) {
+         if (errors[i] < errors[lane] ||
+             (errors[i] == errors[lane] && candidates[i] < candidates[lane]))
+            lane = i;
+      }
+      indices[t] = static_cast<uint8_t>(candidates[lane]);
+      total += errors[lane];
+   }
+#else
+   for (int t = 0; t < 16; t++) {
+      float best = FLT_MAX;
+      for (int k = 0; k < palette.size; k++) {
+         float error = 0.0f;
+         for (int c = 0; c < 4; c++) {
+            const float d = palette.channels[c][k] - texels[t][c];
+            error += d * d;
+         }
+         if (error < best) {
+            best = error;
+            indices[t] = static_cast<uint8_t>(k);
+         }
+      }
+      total += best;
+   }
+#endif
+
+   return total;
+}
+
+/// Ends of the principal axis of the first channels through the texels,
+/// found by power iteration on their covariance
+static void principalRange(const BlockTexels texels, int channels,
+                           float low[4], float high[4]) {
+   float mean[4] = {};
+   float minimum[4], maximum[4];
+   for (int c = 0; c < 4; c++) {
+      minimum[c] = maximum[c] = texels[0][c];
+      for (int t = 0; t < 16; t++) {
+         mean[c] += texels[t][c];
+         minimum[c] = std::min(minimum[c], texels[t][c]);
+         maximum[c] = std::max(maximum[c], texels[t][c]);
+      }
+      mean[c] /= 16.0f;
+      low[c] = high[c] = mean[c];
+   }
+
+   float covariance[4][4] = {};
+   for (int t = 0; t < 16; t++) {
+      for (int i = 0; i < channels; i++) {
+         for (int j = 0; j < channels; j++)
+            covariance[i][j] +=
+                (texels[t][i] - mean[i]) * (texels[t][j] - mean[j]);
+      }
+   }
+
+   // The bounding box diagonal is a good first guess
+   float axis[4] = {};
+   for (int c = 0; c < channels; c++)
+      axis[c] = maximum[c] - minimum[c];
+   for (int iteration = 0; iteration < 8; iteration++) {
+      float next[4] = {};
+      float length = 0.0f;
+      for (int i = 0; i < channels; i++) {
+         for (int j = 0; j < channels; j++)
+            next[i] += covariance[i][j] * axis[j];
+         length = std::max(length, std::fabs(next[i]));
+      }
+      if (length == 0.0f)
+         return;
+      for (int c = 0; c < channels; c++)
+         axis[c] = next[c] / length;
+   }
+
+   float lengthSquared = 0.0f;
+   for (int c = 0; c < channels; c++)
+      lengthSquared += axis[c] * axis[c];
+   if (lengthSquared == 0.0f)
+      return;
+
+   float lowest = FLT_MAX, highest = -FLT_MAX;
+   for (int t = 0; t < 16; t++) {
+      float projection = 0.0f;
+      for (int c = 0; c < channels; c++)
+         projection += (texels[t][c] - mean[c]) * axis[c];
+      lowest = std::min(lowest, projection);
+      highest = std::max(highest, projection);
+   }
+
+   for (int c = 0; c < channels; c++) {
+      const float scale = axis[c] / lengthSquared;
+      low[c] = std::clamp(mean[c] + lowest * scale, 0.0f, 255.0f);
+      high[c] = std::clamp(mean[c] + highest * scale, 0.0f, 255.0f);
+   }
+}
+
+/// Least squares endpoints for fixed indices. weights[i] is the share of
+/// endpoint b in palette entry i. Returns false if all texels use one entry
+static bool fitEndpoints(const BlockTexels texels, const uint8_t indices[16],
+                         const float *weights, int channels, float a[4],
+                         float b[4]) {
+   float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+   float ax[4] = {}, bx[4] = {};
+   for (int t = 0; t < 16; t++) {
+      const float wb = weights[indices[t]];
+      const float wa = 1.0f - wb;
+      aa += wa * wa;
+      ab += wa * wb;
+      bb += wb * wb;
+      for (int c = 0; c < channels; c++) {
+         ax[c] += wa * texels[t][c];
+         bx[c] += wb * texels[t][c];
+      }
+   }
+
+   const float determinant = aa * bb - ab * ab;
+   if (std::fabs(determinant) < 1e-6f)
+      return false;
+
+   for (int c = 0; c < channels; c++) {
+      a[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+      b[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+   }
+   return true;
+}
+
+/// Writes fields of a block starting at its least significant bit
+struct BitWriter {
+   uint8_t *out;
+   int bit = 0;
+
+   void put(uint32_t value, int count) {
+      for (int i = 0; i < count; i++, bit++) {
+         if (value >> i & 1)
+            out[bit >> 3] |= uint8_t(1 << (bit & 7));
+      }
+   }
+};
+
+/// --- BC1 ---
+static uint16_t packRGB565(const float color[4]) {
+   const int r = int(std::lround(color[0] * 31.0f / 255.0f));
+   const int g = int(std::lround(color[1] * 63.0f / 255.0f));
+   const int b = int(std::lround(color[2] * 31.0f / 255.0f));
+   return uint16_t(r << 11 | g << 5 | b);
+}
+
+static void unpackRGB565(uint16_t packed, float color[4]) {
+   const int r = packed >> 11 & 31, g = packed >> 5 & 63, b = packed & 31;
+   color[0] = float(r << 3 | r >> 2);
+   color[1] = float(g << 2 | g >> 4);
+   color[2] = float(b << 3 | b >> 2);
+   color[3] = 0.0f;
+}
+
+/// Share of color1 in the entries of four color mode
+static const float bc1Weights[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+static float encodeBC1Colors(const BlockTexels texels, const float a[4],
+                             const float b[4], uint16_t &color0,
+                             uint16_t &color1, uint8_t indices[16]) {
+   color0 = packRGB565(a);
+   color1 = packRGB565(b);
+
+   // Four color mode needs color0 > color1, equal ends take index 0 only
+   if (color0 < color1)
+      std::swap(color0, color1);
+   if (color0 == color1) {
+      std::fill_n(indices, 16, 0);
+      float end[4];
+      unpackRGB565(color0, end);
+      float error = 0.0f;
+      for (int t = 0; t < 16; t++) {
+         for (int c = 0; c < 3; c++)
+            error += (end[c] - texels[t][c]) * (end[c] - texels[t][c]);
+      }
+      return error;
+   }
+
+   float end0[4], end1[4];
+   unpackRGB565(color0, end0);
+   unpackRGB565(color1, end1);
+   Palette palette = {};
+   palette.size = 4;
+   for (int k = 0; k < 4; k++) {
+      for (int c = 0; c < 3; c++)
+         palette.channels[c][k] =
+             end0[c] + (end1[c] - end0[c]) * bc1Weights[k];
+   }
+
+   // Alpha is not part of the colors, compare without it
+   BlockTexels opaque;
+   for (int t = 0; t < 16; t++) {
+      std::memcpy(opaque[t], texels[t], sizeof(opaque[t]));
+      opaque[t][3] = 0.0f;
+   }
+   return nearestIndices(opaque, palette, indices);
+}
+
+static void encodeBC1(const BlockTexels texels, uint8_t *out) {
+   float a[4], b[4];
+   principalRange(texels, 3, b, a);
+
+   uint16_t color0, color1;
+   uint8_t indices[16];
+   float error = encodeBC1Colors(texels, a, b, color0, color1, indices);
+
+   // One least squares pass on the indices of the first fit
+   if (error > 0.0f && fitEndpoints(texels, indices, bc1Weights, 3, a, b)) {
+      uint16_t fitted0, fitted1;
+      uint8_t fittedIndices[16];
+      const float fitted =
+          encodeBC1Colors(texels, a, b, fitted0, fitted1, fittedIndices);
+      if (fitted < error) {
+         color0 = fitted0;
+         color1 = fitted1;
+         std::memcpy(indices, fittedIndices, 16);
+      }
+   }
+
+   std::memset(out, 0, 8);
+   BitWriter writer{out};
+   writer.put(color0, 16);
+   writer.put(color1, 16);
+   for (int t = 0; t < 16; t++)
+      writer.put(indices[t], 2);
+}
+
+/// --- BC4 ---
+/// One channel at 3 bits per texel, between its minimum and maximum
+static void encodeBC4(const BlockTexels texels, int channel, uint8_t *out) {
+   float lowest = 255.0f, highest = 0.0f;
+   for (int t = 0; t < 16; t++) {
+      lowest = std::min(lowest, texels[t][channel]);
+      highest = std::max(highest, texels[t][channel]);
+   }
+   const int value0 = int(std::lround(highest));
+   const int value1 = int(std::lround(lowest));
+
+   std::memset(out, 0, 8);
+   BitWriter writer{out};
+   writer.put(value0, 8);
+   writer.put(value1, 8);
+   if (value0 == value1)
+      return;
+
+   // Eight evenly spaced values from value0 down to value1, in the order
+   // value0, value1, then the six between them
+   for (int t = 0; t < 16; t++) {
+      const float step = (value0 - texels[t][channel]) * 7.0f /
+                         float(value0 - value1);
+      const int position = std::clamp(int(std::lround(step)), 0, 7);
+      const int index =
+          position == 0 ? 0 : position == 7 ? 1 : position + 1;
+      writer.put(index, 3);
+   }
+}
+
+/// --- BC7 ---
+/// Share of endpoint b in 64ths for 4-bit indices
+static const int bc7Weights[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                   34, 38, 43, 47, 51, 55, 60, 64};
+
+/// Mode 6 endpoint: 7 bits per channel plus a shared low bit
+struct Mode6Endpoint {
+   int value[4];
+   int pbit;
+
+   int expanded(int channel) const { return value[channel] << 1 | pbit; }
+};
+
+static Mode6Endpoint quantizeMode6(const float color[4]) {
+   Mode6Endpoint best = {};
+   float bestError = FLT_MAX;
+   for (int pbit = 0; pbit < 2; pbit++) {
+      Mode6Endpoint endpoint;
+      endpoint.pbit = pbit;
+      float error = 0.0f;
+      for (int c = 0; c < 4; c++) {
+         endpoint.value[c] =
+             std::clamp(int(std::lround((color[c] - pbit) * 0.5f)), 0, 127);
+         const float d = endpoint.expanded(c) - color[c];
+         error += d * d;
+      }
+      if (error < bestError) {
+         bestError = error;
+         best = endpoint;
+      }
+   }
+   return best;
+}
+
+static float encodeMode6(const BlockTexels texels, const float a[4],
+                         const float b[4], Mode6Endpoint &endpoint0,
+                         Mode6Endpoint &endpoint1, uint8_t indices[16]) {
+   endpoint0 = quantizeMode6(a);
+   endpoint1 = quantizeMode6(b);
+
+   Palette palette;
+   palette.size = 16;
+   for (int k = 0; k < 16; k++) {
+      for (int c = 0; c < 4; c++)
+         palette.channels[c][k] = float(
+             ((64 - bc7Weights[k]) * endpoint0.expanded(c) +
+              bc7Weights[k] * endpoint1.expanded(c) + 32) >>
+             6);
+   }
+   return nearestIndices(texels, palette, indices);
+}
+
+static void encodeBC7(const BlockTexels texels, uint8_t *out) {
+   float a[4], b[4];
+   principalRange(texels, 4, a, b);
+
+   Mode6Endpoint endpoint0, endpoint1;
+   uint8_t indices[16];
+   float error = encodeMode6(texels, a, b, endpoint0, endpoint1, indices);
+
+   static const float weights[16] = {
+       0 / 64.0f,  4 / 64.0f,  9 / 64.0f,  13 / 64.0f, 17 / 64.0f, 21 / 64.0f,
+       26 / 64.0f, 30 / 64.0f, 34 / 64.0f, 38 / 64.0f, 43 / 64.0f, 47 / 64.0f,
+       51 / 64.0f, 55 / 64.0f, 60 / 64.0f, 64 / 64.0f};
+   if (error > 0.0f && fitEndpoints(texels, indices, weights, 4, a, b)) {
+      Mode6Endpoint fitted0, fitted1;
+      uint8_t fittedIndices[16];
+      const float fitted =
+          encodeMode6(texels, a, b, fitted0, fitted1, fittedIndices);
+      if (fitted < error) {
+         endpoint0 = fitted0;
+         endpoint1 = fitted1;
+         std::memcpy(indices, fittedIndices, 16);
+      }
+   }
+
+   // The top index bit of the first texel is implied 0
+   if (indices[0] >= 8) {
+      std::swap(endpoint0, endpoint1);
+      for (uint8_t &index : indices)
+         index = uint8_t(15 - index);
+   }
+
+   std::memset(out, 0, 16);
+   BitWriter writer{out};
+   writer.put(1 << 6, 7);
+   for (int c = 0; c < 4; c++) {
+      writer.put(endpoint0.value[c], 7);
+      writer.put(endpoint1.value[c], 7);
+   }
+   writer.put(endpoint0.pbit, 1);
+   writer.put(endpoint1.pbit, 1);
+   writer.put(indices[0], 3);
+   for (int t = 1; t < 16; t++)
+      writer.put(indices[t], 4);
+}
+
+/// --- Images ---
+void compressImage(const uint8_t *rgba, int width, int height,
+                   BlockFormat format, uint8_t *blocks) {
+   const size_t bytes = blockBytes(format);
+   BlockTexels texels;
+
+   for (int by = 0; by < height; by += 4) {
+      for (int bx = 0; bx < width; bx += 4) {
+         for (int t = 0; t < 16; t++) {
+            const int x = std::min(bx + (t & 3), width - 1);
+            const int y = std::min(by + (t >> 2), height - 1);
+            const uint8_t *texel = rgba + (size_t(y) * width + x) * 4;
+            for (int c = 0; c < 4; c++)
+               texels[t][c] = texel[c];
+         }
+
+         switch (format) {
+         case BlockFormat::BC1:
+            encodeBC1(texels, blocks);
+            break;
+         case BlockFormat::BC3:
+            encodeBC4(texels, 3, blocks);
+            encodeBC1(texels, blocks + 8);
+            break;
+         case BlockFormat::BC5:
+            encodeBC4(texels, 0, blocks);
+            encodeBC4(texels, 1, blocks + 8);
+            break;
+         case BlockFormat::BC7:
+            encodeBC7(texels, blocks);
+            break;
+         }
+         blocks += bytes;
+      }
+   }
+}
@@ -0,0 +1,400 @@
+#include "bvh.h"
+
+// C++ Libraries
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <limits>
+
+/// --- Helpers ---
+static float halfArea(const glm::vec3 &boundsMin,
+                      const glm::vec3 &boundsMax) {
+   const glm::vec3 extent = boundsMax - boundsMin;
+   return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+static void setLeafBounds(BvhNode &node,
+                          const std::vector<uint32_t> &primitives,
+                          const std::vector<Aabb> &boxes) {
+   node.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+   node.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+   for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+      node.boundsMin = glm::min(node.boundsMin, boxes[primitives[i]].min);
+      node.boundsMax = glm::max(node.boundsMax, boxes[primitives[i]].max);
+   }
+}
+
+static bool intersectRay(const glm::vec3 &boundsMin,
+                         const glm::vec3 &boundsMax, const glm::vec3 &origin,
+                         const glm::vec3 &inverse, float maxDistance,
+                         float &distance) {
+   const glm::vec3 t0 = (boundsMin - origin) * inverse;
+   const glm::vec3 t1 = (boundsMax - origin) * inverse;
+   const glm::vec3 near = glm::min(t0, t1);
+   const glm::vec3 far = glm::max(t0, t1);
+
+   distance = std::max({near.x, near.y, near.z, 0.0f});
+   const float exit = std::min({far.x, far.y, far.z});
+   return distance <= exit && distance < maxDistance;
+}
+
+/// --- Build ---
+// Splits are evaluated at the boundaries of this many centroid bins per axis
+static const int sahBins = 16;
+
+// Cost of visiting a node relative to testing one primitive, leaves are
+// tested in SIMD batches so primitives are cheap
+static const float sahTraversalCost = 1.0f;
+static const float sahPrimitiveCost = 0.25f;
+
+struct BuildContext {
+   std::vector<uint32_t> &primitives;
+   const std::vector<Aabb> &boxes;
+   const std::vector<glm::vec3> &centroids;
+};
+
+// Splits nodes[index] in place, appends two children and returns true
+static bool splitNode(std::vector<BvhNode> &nodes, uint32_t index,
+                      const BuildContext &context) {
+   const BvhNode node = nodes[index];
+   if (node.count <= 1)
+      return false;
+
+   const uint32_t begin = node.leftFirst, end = node.leftFirst + node.count;
+   glm::vec3 centroidMin(std::numeric_limits<float>::max());
+   glm::vec3 centroidMax(-std::numeric_limits<float>::max());
+   for (uint32_t i = begin; i < end; i++) {
+      const glm::vec3 &centroid = context.centroids[context.primitives[i]];
+      centroidMin = glm::min(centroidMin, centroid);
+      centroidMax = glm::max(centroidMax, centroid);
+   }
+
+   // Cheapest bin boundary over all axes
+   int bestAxis = -1, bestSplit = 0;
+   float bestCost = std::numeric_limits<float>::max();
+   for (int axis = 0; axis < 3; axis++) {
+      const float extent = centroidMax[axis] - centroidMin[axis];
+      if (extent <= 0.0f)
+         continue;
+
+      struct Bin {
+         glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+         glm::vec3 boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+         uint32_t count = 0;
+      } bins[sahBins];
+
+      const float scale = sahBins / extent;
+      for (uint32_t i = begin; i < end; i++) {
+         const uint32_t primitive = context.primitives[i];
+         const int bin = std::min(
+             sahBins - 1,
+             int((context.centroids[primitive][axis] - centroidMin[axis]) *
+                 scale));
+         bins[bin].boundsMin =
+             glm::min(bins[bin].boundsMin, context.boxes[primitive].min);
+         bins[bin].boundsMax =
+             glm::max(bins[bin].boundsMax, context.boxes[primitive].max);
+         bins[bin].count++;
+      }
+
+      // Sweep from the right to get the cost of every right hand side
+      float rightArea[sahBins - 1];
+      uint32_t rightCount[sahBins - 1];
+      Bin right;
+      for (int i = sahBins - 1; i > 0; i--) {
+         right.boundsMin = glm::min(right.boundsMin, bins[i].boundsMin);
+         right.boundsMax = glm::max(right.boundsMax, bins[i].boundsMax);
+         right.count += bins[i].count;
+         rightArea[i - 1] =
+             right.count ? halfArea(right.boundsMin, right.boundsMax) : 0.0f;
+         rightCount[i - 1] = right.count;
+      }
+
+      Bin left;
+      for (int i = 0; i < sahBins - 1; i++) {
+         left.boundsMin = glm::min(left.boundsMin, bins[i].boundsMin);
+         left.boundsMax = glm::max(left.boundsMax, bins[i].boundsMax);
+         left.count += bins[i].count;
+         if (left.count == 0 || rightCount[i] == 0)
+            continue;
+
+         const float cost =
+             left.count * halfArea(left.boundsMin, left.boundsMax) +
+             rightCount[i] * rightArea[i];
+         if (cost < bestCost) {
+            bestCost = cost;
+            bestAxis = axis;
+            bestSplit = i + 1;
+         }
+      }
+   }
+
+   // Keep the leaf if splitting does not pay off and it is small enough
+   const float area = halfArea(node.boundsMin, node.boundsMax);
+   const float leafCost = sahPrimitiveCost * node.count * area;
+   const float splitCost =
+       sahTraversalCost * area + sahPrimitiveCost * bestCost;
+   if (node.count <= bvhMaxLeafSize && splitCost >= leafCost)
+      return false;
+
+   uint32_t middle;
+   if (bestAxis >= 0) {
+      const float axisMin = centroidMin[bestAxis];
+      const float scale = sahBins / (centroidMax[bestAxis] - axisMin);
+      middle = uint32_t(
+          std::partition(context.primitives.begin() + begin,
+                         context.primitives.begin() + end,
+                         [&](uint32_t primitive) {
+                            const int bin = std::min(
+                                sahBins - 1,
+                                int((context.centroids[primitive][bestAxis] -
+                                     axisMin) *
+                                    scale));
+                            return bin < bestSplit;
+                         }) -
+          context.primitives.begin());
+   } else {
+      // Coincident centroids, any split is as good as another
+      middle = begin + node.count / 2;
+   }
+
+   BvhNode left = {}, right = {};
+   left.leftFirst = begin;
+   left.count = middle - begin;
+   right.leftFirst = middle;
+   right.count = end - middle;
+   setLeafBounds(left, context.primitives, context.boxes);
+   setLeafBounds(right, context.primitives, context.boxes);
+
+   nodes[index].leftFirst = uint32_t(nodes.size());
+   nodes[index].count = 0;
+   nodes.push_back(left);
+   nodes.push_back(right);
+   return true;
+}
+
+static void buildSubtree(std::vector<BvhNode> &nodes, uint32_t root,
+                         const BuildContext &context) {
+   std::vector<uint32_t> stack = {root};
+   while (!stack.empty()) {
+      const uint32_t index = stack.back();
+      stack.pop_back();
+
+      if (splitNode(nodes, index, context)) {
+         stack.push_back(nodes[index].leftFirst + 1);
+         stack.push_back(nodes[index].leftFirst);
+      }
+   }
+}
+
+void Bvh::build(const std::vector<Aabb> &boxes, ThreadPool *pool) {
+   nodes.clear();
+   primitives.resize(boxes.size());
+   for (uint32_t i = 0; i < primitives.size(); i++)
+      primitives[i] = i;
+
+   primitiveBounds.clear();
+   if (boxes.empty())
+      return;
+
+   std::vector<glm::vec3> centroids(boxes.size());
+   for (size_t i = 0; i < boxes.size(); i++)
+      centroids[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+
+   const BuildContext context = {primitives, boxes, centroids};
+
+   BvhNode root = {};
+   root.count = uint32_t(boxes.size());
+   setLeafBounds(root, primitives, boxes);
+   nodes.reserve(boxes.size() * 2);
+   nodes.push_back(root);
+
+   // Split the top levels here until there are enough subtrees to keep the
+   // workers busy, every subtree owns a disjoint range of primitives
+   const size_t taskSize =
+       pool ? std::max<size_t>(boxes.size() / (pool->size() * 4), 1024)
+            : boxes.size();
+   std::vector<uint32_t> subtrees;
+   std::vector<uint32_t> stack = {0};
+   while (!stack.empty()) {
+      const uint32_t index = stack.back();
+      stack.pop_back();
+
+      if (nodes[index].count > taskSize && splitNode(nodes, index, context)) {
+         stack.push_back(nodes[index].leftFirst + 1);
+         stack.push_back(nodes[index].leftFirst);
+      } else {
+         subtrees.push_back(index);
+      }
+   }
+
+   // Each subtree is built into its own array with the root at 0
+   std::vector<std::vector<BvhNode>> built(subtrees.size());
+   auto buildTask = [&](size_t i) {
+      built[i].push_back(nodes[subtrees[i]]);
+      buildSubtree(built[i], 0, context);
+   };
+
+   if (pool && subtrees.size() > 1) {
+      std::vector<std::future<void>> tasks;
+      for (size_t i = 0; i < subtrees.size(); i++)
+         tasks.push_back(pool->submit([&buildTask, i]() { buildTask(i); }));
+      for (std::future<void> &task : tasks)
+         task.get();
+   } else {
+      for (size_t i = 0; i < subtrees.size(); i++)
+         buildTask(i);
+   }
+
+   // Append the subtrees, children always follow their parent which refit
+   // relies on
+   for (size_t i = 0; i < subtrees.size(); i++) {
+      const uint32_t base = uint32_t(nodes.size()) - 1;
+      for (size_t j = 0; j < built[i].size(); j++) {
+         BvhNode node = built[i][j];
+         if (node.count == 0)
+            node.leftFirst += base;
+
+         if (j == 0)
+            nodes[subtrees[i]] = node;
+         else
+            nodes.push_back(node);
+      }
+   }
+
+   primitiveBounds.resize(boxes.size());
+   for (size_t i = 0; i < primitives.size(); i++)
+      primitiveBounds[i] = boxes[primitives[i]];
+}
+
+void Bvh::refit(const std::vector<Aabb> &boxes) {
+   for (size_t i = 0; i < primitives.size(); i++)
+      primitiveBounds[i] = boxes[primitives[i]];
+
+   for (size_t i = nodes.size(); i-- > 0;) {
+      BvhNode &node = nodes[i];
+      if (node.count == 0) {
+         const BvhNode &left = nodes[node.leftFirst];
+         const BvhNode &right = nodes[node.leftFirst + 1];
+         node.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+         node.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+      } else {
+         node.boundsMin = primitiveBounds[node.leftFirst].min;
+         node.boundsMax = primitiveBounds[node.leftFirst].max;
+         for (uint32_t j = 1; j < node.count; j++) {
+            const Aabb &box = primitiveBounds[node.leftFirst + j];
+            node.boundsMin = glm::min(node.boundsMin, box.min);
+            node.boundsMax = glm::max(node.boundsMax, box.max);
+         }
+      }
+   }
+}
+
+/// --- Queries ---
+void Bvh::cull(const Frustum &frustum, const BvhVisitor &visitor) const {
+   if (nodes.empty())
+      return;
+
+   // Planes a node is fully inside of are not tested again below it
+   struct Entry {
+      uint32_t node;
+      uint32_t planeMask;
+   };
+   std::vector<Entry> stack;
+   stack.reserve(64);
+   stack.push_back({0, (1u << 6) - 1});
+
+   while (!stack.empty()) {
+      const Entry entry = stack.back();
+      stack.pop_back();
+      const BvhNode &node = nodes[entry.node];
+
+      const glm::vec3 center = (node.boundsMin + node.boundsMax) * 0.5f;
+      const glm::vec3 extent = (node.boundsMax - node.boundsMin) * 0.5f;
+      uint32_t planeMask = entry.planeMask;
+      bool outside = false;
+      for (int i = 0; i < 6 && !outside; i++) {
+         if (!(planeMask & (1u << i)))
+            continue;
+
+         const glm::vec4 &plane = frustum.planes[i];
+         const float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+         const float radius = glm::dot(glm::abs(glm::vec3(plane)), extent);
+         outside = distance + radius < 0.0f;
+         if (distance - radius >= 0.0f)
+            planeMask &= ~(1u << i);
+      }
+      if (outside)
+         continue;
+
+      if (node.count > 0) {
+         visitor(node.leftFirst, node.count, planeMask == 0);
+      } else if (planeMask == 0) {
+         // Fully visible, report the leaves without any further tests
+         stack.push_back({node.leftFirst, 0});
+         stack.push_back({node.leftFirst + 1, 0});
+      } else {
+         stack.push_back({node.leftFirst, planeMask});
+         stack.push_back({node.leftFirst + 1, planeMask});
+      }
+   }
+}
+
+bool Bvh::raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                  BvhHit &hit) const {
+   if (nodes.empty())
+      return false;
+
+   const glm::vec3 inverse = 1.0f / direction;
+   hit.distance = std::numeric_limits<float>::max();
+   bool found = false;
+
+   std::vector<uint32_t> stack;
+   stack.reserve(64);
+   float distance;
+   if (intersectRay(nodes[0].boundsMin, nodes[0].boundsMax, origin, inverse,
+                    hit.distance, distance))
+      stack.push_back(0);
+
+   while (!stack.empty()) {
+      const BvhNode &node = nodes[stack.back()];
+      stack.pop_back();
+
+      if (node.count > 0) {
+         for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count;
+              i++) {
+            if (intersectRay(primitiveBounds[i].min, primitiveBounds[i].max,
+                             origin, inverse, hit.distance, distance)) {
+               hit.primitive = primitives[i];
+               hit.distance = distance;
+               found = true;
+            }
+         }
+         continue;
+      }
+
+      // Visit the nearer child first so that farther ones get rejected
+      float nearDistance, farDistance;
+      uint32_t nearChild = node.leftFirst, farChild = node.leftFirst + 1;
+      bool nearHit =
+          intersectRay(nodes[nearChild].boundsMin, nodes[nearChild].boundsMax,
+                       origin, inverse, hit.distance, nearDistance);
+      bool farHit =
+          intersectRay(nodes[farChild].boundsMin, nodes[farChild].boundsMax,
+                       origin, inverse, hit.distance, farDistance);
+      if (nearHit && farHit && farDistance < nearDistance) {
+         std::swap(nearChild, farChild);
+         std::swap(nearDistance, farDistance);
+      } else if (!nearHit) {
+         std::swap(nearChild, farChild);
+         std::swap(nearHit, farHit);
+      }
+
+      if (farHit)
+         stack.push_back(farChild);
+      if (nearHit)
+         stack.push_back(nearChild);
+   }
+
+   return found;
+}
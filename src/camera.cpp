@@ -33,6 +33,15 @@ void Camera::setDirection(const float &xoffset, const float &yoffset) {
    cameraFront = glm::normalize(direction);
 }
 
+void Camera::setTarget(const glm::vec3 &target) {
+   const glm::vec3 direction = glm::normalize(target - Position);
+
+   // Keep yaw and pitch in sync, mouse movement continues from here
+   pitch = glm::degrees(asinf(direction.y));
+   yaw = glm::degrees(atan2f(direction.z, direction.x));
+   setDirection(0.0f, 0.0f);
+}
+
 /// --- Projection ---
 void Camera::setZoom(const float &yoffset) {
    fov -= yoffset;
@@ -51,3 +60,15 @@ glm::mat4 Camera::getProjection(const float &aspect, const float &nearPlane,
                                 const float &farPlane) const {
    return glm::perspective(glm::radians(fov), aspect, nearPlane, farPlane);
 }
+
+/// --- Picking ---
+void Camera::getRay(const float &x, const float &y, const float &aspect,
+                    glm::vec3 &origin, glm::vec3 &direction) const {
+   const float tanHalfFov = tan(glm::radians(fov) * 0.5f);
+   const glm::vec3 right = glm::normalize(glm::cross(cameraFront, cameraUp));
+   const glm::vec3 up = glm::cross(right, cameraFront);
+
+   origin = Position;
+   direction = glm::normalize(cameraFront + right * (x * tanHalfFov * aspect) +
+                              up * (y * tanHalfFov));
+}
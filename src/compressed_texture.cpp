@@ -0,0 +1,169 @@
+#include "compressed_texture.h"
+
+// C++ Libraries
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+// Project Libraries
+#include "debug.h"
+#include "mapped_file.h"
+
+BlockFormat chooseBlockFormat(TextureKind kind, bool hasAlpha, bool s3tc) {
+   if (kind == TextureKind::Normal)
+      return BlockFormat::BC5;
+   if (!s3tc)
+      return BlockFormat::BC7;
+   return hasAlpha ? BlockFormat::BC3 : BlockFormat::BC1;
+}
+
+CompressedImage compressMipChain(const MipChain &chain, BlockFormat format) {
+   CompressedImage image;
+   image.format = format;
+   for (const ImageLevel &level : chain.levels) {
+      ImageLevel compressed = level;
+      compressed.offset = image.data.size();
+      compressed.size = compressedSize(format, level.width, level.height);
+      image.data.resize(compressed.offset + compressed.size);
+      compressImage(chain.data.data() + level.offset, level.width,
+                    level.height, format,
+                    image.data.data() + compressed.offset);
+      image.levels.push_back(compressed);
+   }
+   return image;
+}
+
+/// --- DDS Files ---
+static constexpr uint32_t fourCC(const char (&code)[5]) {
+   return uint32_t(code[0]) | uint32_t(code[1]) << 8 | uint32_t(code[2]) << 16 |
+          uint32_t(code[3]) << 24;
+}
+
+static uint32_t dxgiFormat(BlockFormat format) {
+   switch (format) {
+   case BlockFormat::BC1:
+      return 71;
+   case BlockFormat::BC3:
+      return 77;
+   case BlockFormat::BC5:
+      return 83;
+   case BlockFormat::BC7:
+      return 98;
+   }
+   return 0;
+}
+
+static bool blockFormat(uint32_t dxgi, BlockFormat &format) {
+   for (BlockFormat candidate : {BlockFormat::BC1, BlockFormat::BC3,
+                                 BlockFormat::BC5, BlockFormat::BC7}) {
+      if (dxgiFormat(candidate) == dxgi) {
+         format = candidate;
+         return true;
+      }
+   }
+   return false;
+}
+
+const uint8_t *DdsCache::map(const std::string &sourcePath,
+                             uint64_t sourceHash, MappedFile &file,
+                             CompressedImage &image) {
+   if (!file.open(cachePath(sourcePath)))
+      return nullptr;
+
+   const size_t headersSize = sizeof(DdsHeader) + sizeof(DdsHeaderDx10);
+   if (file.size() < headersSize)
+      return nullptr;
+
+   DdsHeader header;
+   DdsHeaderDx10 dx10;
+   std::memcpy(&header, file.data(), sizeof(header));
+   std::memcpy(&dx10, file.data() + sizeof(header), sizeof(dx10));
+
+   uint64_t hash;
+   std::memcpy(&hash, &header.reserved[2], sizeof(hash));
+   if (header.magic != fourCC("DDS ") ||
+       header.pixelFormat.fourCC != fourCC("DX10") ||
+       header.reserved[0] != fourCC("3DVT") ||
+       header.reserved[1] != textureCacheVersion || hash != sourceHash ||
+       !blockFormat(dx10.dxgiFormat, image.format) || header.mipCount > 32)
+      return nullptr;
+
+   // Every level down to 1x1 has to be there
+   int width = int(header.width), height = int(header.height);
+   size_t offset = 0;
+   image.levels.clear();
+   for (uint32_t i = 0; i < header.mipCount; i++) {
+      ImageLevel level;
+      level.width = width;
+      level.height = height;
+      level.offset = offset;
+      level.size = compressedSize(image.format, width, height);
+      image.levels.push_back(level);
+      offset += level.size;
+
+      width = std::max(width / 2, 1);
+      height = std::max(height / 2, 1);
+   }
+
+   if (image.levels.empty() || image.levels.back().width != 1 ||
+       image.levels.back().height != 1 ||
+       file.size() != headersSize + offset) {
+      image.levels.clear();
+      return nullptr;
+   }
+
+   image.data.clear();
+   return file.data() + headersSize;
+}
+
+bool DdsCache::write(const std::string &sourcePath, uint64_t sourceHash,
+                     const CompressedImage &image) {
+   if (image.empty())
+      return false;
+
+   DdsHeader header = {};
+   header.magic = fourCC("DDS ");
+   header.size = sizeof(DdsHeader) - sizeof(header.magic);
+   // Caps, height, width, pixel format, mip count and linear size
+   header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;
+   header.width = uint32_t(image.levels[0].width);
+   header.height = uint32_t(image.levels[0].height);
+   header.linearSize = uint32_t(image.levels[0].size);
+   header.mipCount = uint32_t(image.levels.size());
+   header.reserved[0] = fourCC("3DVT");
+   header.reserved[1] = textureCacheVersion;
+   std::memcpy(&header.reserved[2], &sourceHash, sizeof(sourceHash));
+   header.pixelFormat.size = sizeof(DdsPixelFormat);
+   header.pixelFormat.flags = 0x4;
+   header.pixelFormat.fourCC = fourCC("DX10");
+   // Texture, mipmap and complex
+   header.caps[0] = 0x1000 | 0x400000 | 0x8;
+
+   DdsHeaderDx10 dx10 = {};
+   dx10.dxgiFormat = dxgiFormat(image.format);
+   dx10.dimension = 3;
+   dx10.arraySize = 1;
+
+   // Write to a temporary file first so readers never see a partial cache
+   const std::string path = cachePath(sourcePath);
+   const std::string temporary = path + ".tmp";
+   std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+   if (!stream.is_open()) {
+      debugMsg("DdsCache", "Failed to create " + temporary);
+      return false;
+   }
+
+   stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+   stream.write(reinterpret_cast<const char *>(&dx10), sizeof(dx10));
+   stream.write(reinterpret_cast<const char *>(image.data.data()),
+                image.data.size());
+   stream.close();
+
+   if (!stream || std::rename(temporary.c_str(), path.c_str()) != 0) {
+      debugMsg("DdsCache", "Failed to write " + path);
+      std::remove(temporary.c_str());
+      return false;
+   }
+   return true;
+}
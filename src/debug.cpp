@@ -0,0 +1,22 @@
+#include "debug.h"
+
+// C++ Libraries
+#include <iostream>
+#include <utility>
+
+static DebugHandler &currentHandler() {
+   static DebugHandler instance = [](const std::string &source,
+                                     const std::string &message) {
+      std::cout << "[DEBUG] " << source << ": " << message << "\n"
+                << std::flush;
+   };
+   return instance;
+}
+
+void debugMsg(std::string source, std::string error) {
+   currentHandler()(source, error);
+}
+
+void setDebugHandler(DebugHandler handler) {
+   currentHandler() = std::move(handler);
+}
@@ -0,0 +1,139 @@
+#include "frustum.h"
+
+// C++ Libraries
+#include <cmath>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+Frustum::Frustum(const glm::mat4 &viewProjection) {
+   // Rows of the matrix, glm stores columns
+   glm::vec4 rows[4];
+   for (int i = 0; i < 4; i++) {
+      rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i],
+                          viewProjection[2][i], viewProjection[3][i]);
+   }
+
+   planes[0] = rows[3] + rows[0]; // Left
+   planes[1] = rows[3] - rows[0]; // Right
+   planes[2] = rows[3] + rows[1]; // Bottom
+   planes[3] = rows[3] - rows[1]; // Top
+   planes[4] = rows[3] + rows[2]; // Near
+   planes[5] = rows[3] - rows[2]; // Far
+}
+
+bool Frustum::intersects(const glm::vec3 &boundsMin,
+                         const glm::vec3 &boundsMax) const {
+   const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+   const glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+   for (const glm::vec4 &plane : planes) {
+      const float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+      const float radius = glm::dot(glm::abs(glm::vec3(plane)), extent);
+      if (distance + radius < 0.0f)
+         return false;
+   }
+   return true;
+}
+
+void CullingBounds::assign(const std::vector<Mesh> &meshes,
+                           const std::vector<uint32_t> &order) {
+   count = order.size();
+   for (std::vector<float> *array :
+        {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ})
+      array->resize(count);
+
+   for (size_t i = 0; i < count; i++) {
+      const MeshBounds &bounds = meshes[order[i]].bounds;
+      const glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+      const glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+      centerX[i] = center.x;
+      centerY[i] = center.y;
+      centerZ[i] = center.z;
+      extentX[i] = extent.x;
+      extentY[i] = extent.y;
+      extentZ[i] = extent.z;
+   }
+}
+
+void CullingBounds::cull(const Frustum &frustum, size_t first,
+                         size_t rangeCount, uint8_t *visible) const {
+   const size_t end = first + rangeCount;
+
+   // A box is outside once its nearest corner is behind one of the planes:
+   // dot(n, center) + d + dot(|n|, extent) < 0
+   size_t i = first;
+#if defined(__AVX__)
+   for (; i + 8 <= end; i += 8) {
+      const __m256 cx = _mm256_loadu_ps(&centerX[i]);
+      const __m256 cy = _mm256_loadu_ps(&centerY[i]);
+      const __m256 cz = _mm256_loadu_ps(&centerZ[i]);
+      const __m256 ex = _mm256_loadu_ps(&extentX[i]);
+      const __m256 ey = _mm256_loadu_ps(&extentY[i]);
+      const __m256 ez = _mm256_loadu_ps(&extentZ[i]);
+
+      __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+      for (const glm::vec4 &plane : frustum.planes) {
+         const __m256 distance = _mm256_add_ps(
+             _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), cx),
+                           _mm256_mul_ps(_mm256_set1_ps(plane.y), cy)),
+             _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.z), cz),
+                           _mm256_set1_ps(plane.w)));
+         const __m256 radius = _mm256_add_ps(
+             _mm256_add_ps(
+                 _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.x)), ex),
+                 _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.y)), ey)),
+             _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.z)), ez));
+         inside = _mm256_and_ps(
+             inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius),
+                                   _mm256_setzero_ps(), _CMP_GE_OQ));
+      }
+
+      const int mask = _mm256_movemask_ps(inside);
+      for (int k = 0; k < 8; k++)
+         visible[i - first + k] = (mask >> k) & 1;
+   }
+#elif defined(__SSE2__)
+   for (; i + 4 <= end; i += 4) {
+      const __m128 cx = _mm_loadu_ps(&centerX[i]);
+      const __m128 cy = _mm_loadu_ps(&centerY[i]);
+      const __m128 cz = _mm_loadu_ps(&centerZ[i]);
+      const __m128 ex = _mm_loadu_ps(&extentX[i]);
+      const __m128 ey = _mm_loadu_ps(&extentY[i]);
+      const __m128 ez = _mm_loadu_ps(&extentZ[i]);
+
+      __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+      for (const glm::vec4 &plane : frustum.planes) {
+         const __m128 distance =
+             _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx),
+                                   _mm_mul_ps(_mm_set1_ps(plane.y), cy)),
+                        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), cz),
+                                   _mm_set1_ps(plane.w)));
+         const __m128 radius = _mm_add_ps(
+             _mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::fabs(plane.x)), ex),
+                        _mm_mul_ps(_mm_set1_ps(std::fabs(plane.y)), ey)),
+             _mm_mul_ps(_mm_set1_ps(std::fabs(plane.z)), ez));
+         inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius),
+                                                  _mm_setzero_ps()));
+      }
+
+      const int mask = _mm_movemask_ps(inside);
+      for (int k = 0; k < 4; k++)
+         visible[i - first + k] = (mask >> k) & 1;
+   }
+#endif
+
+   // Scalar fallback and tail, same test one box at a time
+   for (; i < end; i++) {
+      bool inside = true;
+      for (const glm::vec4 &plane : frustum.planes) {
+         const float distance = plane.x * centerX[i] + plane.y * centerY[i] +
+                                plane.z * centerZ[i] + plane.w;
+         const float radius = std::fabs(plane.x) * extentX[i] +
+                              std::fabs(plane.y) * extentY[i] +
+                              std::fabs(plane.z) * extentZ[i];
+         inside = inside && distance + radius >= 0.0f;
+      }
+      visible[i - first] = inside;
+   }
+}
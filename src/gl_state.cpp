@@ -0,0 +1,231 @@
+#include "gl_state.h"
+
+// C++ Libraries
+#include <algorithm>
+#include <cstdio>
+
+// Project Libraries
+#include "debug.h"
+
+void GlState::invalidate() {
+   program = unknownName;
+   vertexArray = unknownName;
+   std::fill_n(textures, glStateTextureUnits, unknownName);
+   buffers.clear();
+   std::fill_n(storageBuffers, glStateBufferBindings, BufferRange());
+   std::fill_n(uniformBuffers, glStateBufferBindings, BufferRange());
+   capabilities.clear();
+   polygonMode = GL_NONE;
+   depthMask = -1;
+   blendSource = blendDestination = GL_NONE;
+   unpackAlignment = -1;
+}
+
+/// --- Bindings ---
+void GlState::useProgram(GLuint program) {
+   if (changed(this->program != program)) {
+      glUseProgram(program);
+      this->program = program;
+   }
+}
+
+void GlState::bindVertexArray(GLuint vertexArray) {
+   if (changed(this->vertexArray != vertexArray)) {
+      glBindVertexArray(vertexArray);
+      this->vertexArray = vertexArray;
+   }
+}
+
+void GlState::bindTextureUnit(GLuint unit, GLuint texture) {
+   if (unit >= glStateTextureUnits) {
+      frame.issued++;
+      glBindTextureUnit(unit, texture);
+      return;
+   }
+
+   if (changed(textures[unit] != texture)) {
+      glBindTextureUnit(unit, texture);
+      textures[unit] = texture;
+   }
+}
+
+void GlState::bindTextures(GLuint first, GLsizei count,
+                           const GLuint *textures) {
+   // One call for the whole range if any unit differs
+   bool different = first + count > glStateTextureUnits;
+   for (GLsizei i = 0; !different && i < count; i++)
+      different = this->textures[first + i] != textures[i];
+
+   if (changed(different)) {
+      glBindTextures(first, count, textures);
+      for (GLsizei i = 0; i < count && first + i < glStateTextureUnits; i++)
+         this->textures[first + i] = textures[i];
+   }
+}
+
+void GlState::bindBuffer(GLenum target, GLuint buffer) {
+   auto found = std::find_if(
+       buffers.begin(), buffers.end(),
+       [target](const BufferTarget &bound) { return bound.target == target; });
+   if (found == buffers.end())
+      found = buffers.insert(buffers.end(), {target, unknownName});
+
+   if (changed((*found).buffer != buffer)) {
+      glBindBuffer(target, buffer);
+      (*found).buffer = buffer;
+   }
+}
+
+GlState::BufferRange *GlState::findRange(GLenum target, GLuint index) {
+   if (index >= glStateBufferBindings)
+      return nullptr;
+   if (target == GL_SHADER_STORAGE_BUFFER)
+      return &storageBuffers[index];
+   if (target == GL_UNIFORM_BUFFER)
+      return &uniformBuffers[index];
+   return nullptr;
+}
+
+void GlState::bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+   // A whole buffer binding has no size, 0 tells it from any range
+   BufferRange *range = findRange(target, index);
+   if (!range) {
+      frame.issued++;
+      glBindBufferBase(target, index, buffer);
+      return;
+   }
+
+   if (changed((*range).buffer != buffer || (*range).offset != 0 ||
+               (*range).size != 0)) {
+      glBindBufferBase(target, index, buffer);
+      *range = {buffer, 0, 0};
+   }
+}
+
+void GlState::bindBufferRange(GLenum target, GLuint index, GLuint buffer,
+                              GLintptr offset, GLsizeiptr size) {
+   BufferRange *range = findRange(target, index);
+   if (!range) {
+      frame.issued++;
+      glBindBufferRange(target, index, buffer, offset, size);
+      return;
+   }
+
+   if (changed((*range).buffer != buffer || (*range).offset != offset ||
+               (*range).size != size)) {
+      glBindBufferRange(target, index, buffer, offset, size);
+      *range = {buffer, offset, size};
+   }
+}
+
+/// --- Deletion ---
+void GlState::deleteProgram(GLuint program) {
+   glDeleteProgram(program);
+   if (this->program == program)
+      this->program = unknownName;
+}
+
+void GlState::deleteVertexArray(GLuint vertexArray) {
+   glDeleteVertexArrays(1, &vertexArray);
+   if (this->vertexArray == vertexArray)
+      this->vertexArray = unknownName;
+}
+
+void GlState::deleteTextures(GLsizei count, const GLuint *textures) {
+   glDeleteTextures(count, textures);
+   for (GLsizei i = 0; i < count; i++)
+      std::replace(this->textures, this->textures + glStateTextureUnits,
+                   textures[i], unknownName);
+}
+
+void GlState::deleteBuffers(GLsizei count, const GLuint *buffers) {
+   glDeleteBuffers(count, buffers);
+   for (GLsizei i = 0; i < count; i++) {
+      for (BufferTarget &bound : this->buffers) {
+         if (bound.buffer == buffers[i])
+            bound.buffer = unknownName;
+      }
+      for (GLuint index = 0; index < glStateBufferBindings; index++) {
+         if (storageBuffers[index].buffer == buffers[i])
+            storageBuffers[index] = BufferRange();
+         if (uniformBuffers[index].buffer == buffers[i])
+            uniformBuffers[index] = BufferRange();
+      }
+   }
+}
+
+/// --- Raster State ---
+void GlState::setEnabled(GLenum cap, bool enabled) {
+   auto found = std::find_if(
+       capabilities.begin(), capabilities.end(),
+       [cap](const Capability &known) { return known.cap == cap; });
+   if (found != capabilities.end() && !changed((*found).enabled != enabled))
+      return;
+
+   if (found == capabilities.end()) {
+      frame.issued++;
+      found = capabilities.insert(capabilities.end(), {cap, enabled});
+   }
+   (*found).enabled = enabled;
+
+   if (enabled)
+      glEnable(cap);
+   else
+      glDisable(cap);
+}
+
+void GlState::setPolygonMode(GLenum mode) {
+   if (changed(polygonMode != mode)) {
+      glPolygonMode(GL_FRONT_AND_BACK, mode);
+      polygonMode = mode;
+   }
+}
+
+void GlState::setDepthMask(GLboolean mask) {
+   if (changed(depthMask != GLint(mask))) {
+      glDepthMask(mask);
+      depthMask = mask;
+   }
+}
+
+void GlState::setBlendFunc(GLenum source, GLenum destination) {
+   if (changed(blendSource != source || blendDestination != destination)) {
+      glBlendFunc(source, destination);
+      blendSource = source;
+      blendDestination = destination;
+   }
+}
+
+void GlState::setUnpackAlignment(GLint alignment) {
+   if (changed(unpackAlignment != alignment)) {
+      glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+      unpackAlignment = alignment;
+   }
+}
+
+/// --- Counters ---
+void GlState::beginFrame() {
+   if (frames > 0) {
+      lastFrame = frame;
+      total.issued += frame.issued;
+      total.filtered += frame.filtered;
+   }
+   frame = GlStateCounters();
+   frames++;
+}
+
+void GlState::report() const {
+   // The frame in progress counts as well
+   const size_t issued = total.issued + frame.issued;
+   const size_t filtered = total.filtered + frame.filtered;
+   if (frames == 0 || issued + filtered == 0)
+      return;
+
+   char line[128];
+   std::snprintf(line, sizeof(line),
+                 "%zu frames, per frame %.1f calls issued, %.1f filtered "
+                 "(%.1f%%)",
+                 frames, double(issued) / frames, double(filtered) / frames,
+                 100.0 * filtered / (issued + filtered));
+   debugMsg("GL state", line);
+}
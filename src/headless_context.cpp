@@ -0,0 +1,73 @@
+#include "headless_context.h"
+
+// Graphics Libraries
+#include <glad/glad.h>
+#include <EGL/eglext.h>
+
+// Project Libraries
+#include "debug.h"
+
+HeadlessContext::HeadlessContext() {
+   // The surfaceless platform needs neither a display server nor a GPU, the
+   // default display is the fallback for other EGL implementations
+   auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+       "eglGetPlatformDisplayEXT");
+   if (getPlatformDisplay)
+      display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                   EGL_DEFAULT_DISPLAY, nullptr);
+   if (display == EGL_NO_DISPLAY)
+      display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+   EGLint major, minor;
+   if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+      debugMsg("EGL", "Failed to initialize display");
+      display = EGL_NO_DISPLAY;
+      return;
+   }
+
+   if (!eglBindAPI(EGL_OPENGL_API)) {
+      debugMsg("EGL", "OpenGL is not supported");
+      return;
+   }
+
+   // Rendering goes to framebuffer objects, no config or surface is needed
+   const EGLint attributes[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                4,
+                                EGL_CONTEXT_MINOR_VERSION,
+                                5,
+                                EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                EGL_NONE};
+   context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT,
+                              attributes);
+   if (context == EGL_NO_CONTEXT) {
+      debugMsg("EGL", "Failed to create an OpenGL 4.5 context");
+      return;
+   }
+
+   if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+      debugMsg("EGL", "Failed to make the context current");
+      eglDestroyContext(display, context);
+      context = EGL_NO_CONTEXT;
+      return;
+   }
+
+   // Initialize GLAD
+   if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+      debugMsg("GLAD", "Failed to initialize");
+      eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+      eglDestroyContext(display, context);
+      context = EGL_NO_CONTEXT;
+   }
+}
+
+HeadlessContext::~HeadlessContext() {
+   if (display == EGL_NO_DISPLAY)
+      return;
+
+   if (context != EGL_NO_CONTEXT) {
+      eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+      eglDestroyContext(display, context);
+   }
+   eglTerminate(display);
+}
@@ -0,0 +1,123 @@
+#include "image_writer.h"
+
+// C++ Libraries
+#include <algorithm>
+#include <fstream>
+
+// Project Libraries
+#include "debug.h"
+
+namespace {
+
+uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0) {
+   static uint32_t table[256] = {};
+   if (!table[1]) {
+      for (uint32_t i = 0; i < 256; i++) {
+         uint32_t c = i;
+         for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+         table[i] = c;
+      }
+   }
+
+   crc = ~crc;
+   for (size_t i = 0; i < size; i++)
+      crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+   return ~crc;
+}
+
+void putBigEndian(std::vector<uint8_t> &out, uint32_t value) {
+   out.push_back(uint8_t(value >> 24));
+   out.push_back(uint8_t(value >> 16));
+   out.push_back(uint8_t(value >> 8));
+   out.push_back(uint8_t(value));
+}
+
+/// Length, type, data and a CRC over type and data
+void putChunk(std::vector<uint8_t> &out, const char *type,
+              const std::vector<uint8_t> &data) {
+   putBigEndian(out, uint32_t(data.size()));
+   const size_t typeOffset = out.size();
+   out.insert(out.end(), type, type + 4);
+   out.insert(out.end(), data.begin(), data.end());
+   putBigEndian(out, crc32(out.data() + typeOffset, data.size() + 4));
+}
+
+bool writeFile(const std::string &path, const char *data, size_t size) {
+   std::ofstream file(path, std::ios::binary);
+   if (!file.is_open()) {
+      debugMsg("ImageWriter", "Could not open " + path);
+      return false;
+   }
+
+   file.write(data, size);
+   return bool(file);
+}
+
+} // namespace
+
+bool writePPM(const std::string &path, int width, int height,
+              const std::vector<uint8_t> &pixels) {
+   std::string image = "P6\n" + std::to_string(width) + " " +
+                       std::to_string(height) + "\n255\n";
+   image.append(reinterpret_cast<const char *>(pixels.data()),
+                size_t(width) * height * 3);
+   return writeFile(path, image.data(), image.size());
+}
+
+bool writePNG(const std::string &path, int width, int height,
+              const std::vector<uint8_t> &pixels) {
+   // Every row starts with filter type 0 (none)
+   const size_t rowSize = size_t(width) * 3;
+   std::vector<uint8_t> raw;
+   raw.reserve((rowSize + 1) * height);
+   for (int y = 0; y < height; y++) {
+      raw.push_back(0);
+      raw.insert(raw.end(), pixels.begin() + rowSize * y,
+                 pixels.begin() + rowSize * (y + 1));
+   }
+
+   // zlib stream of stored blocks of up to 65535 bytes each
+   std::vector<uint8_t> compressed = {0x78, 0x01};
+   size_t offset = 0;
+   do {
+      const size_t size = std::min<size_t>(raw.size() - offset, 65535);
+      const bool last = offset + size == raw.size();
+      compressed.push_back(last ? 1 : 0);
+      compressed.push_back(uint8_t(size));
+      compressed.push_back(uint8_t(size >> 8));
+      compressed.push_back(uint8_t(~size));
+      compressed.push_back(uint8_t(~size >> 8));
+      compressed.insert(compressed.end(), raw.begin() + offset,
+                        raw.begin() + offset + size);
+      offset += size;
+   } while (offset < raw.size());
+
+   uint32_t a = 1, b = 0;
+   for (uint8_t byte : raw) {
+      a = (a + byte) % 65521;
+      b = (b + a) % 65521;
+   }
+   putBigEndian(compressed, (b << 16) | a);
+
+   // 8 bit RGB, no interlacing
+   std::vector<uint8_t> header;
+   putBigEndian(header, uint32_t(width));
+   putBigEndian(header, uint32_t(height));
+   header.insert(header.end(), {8, 2, 0, 0, 0});
+
+   std::vector<uint8_t> image = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+   putChunk(image, "IHDR", header);
+   putChunk(image, "IDAT", compressed);
+   putChunk(image, "IEND", {});
+   return writeFile(path, reinterpret_cast<const char *>(image.data()),
+                    image.size());
+}
+
+bool writeImage(const std::string &path, int width, int height,
+                const std::vector<uint8_t> &pixels) {
+   const size_t dot = path.rfind('.');
+   if (dot != std::string::npos && path.substr(dot) == ".ppm")
+      return writePPM(path, width, height, pixels);
+   return writePNG(path, width, height, pixels);
+}
@@ -0,0 +1,68 @@
+#include "instance_buffer.h"
+
+// C++ Libraries
+#include <algorithm>
+
+// Project Libraries
+#include "gl_state.h"
+
+InstanceBuffer::InstanceBuffer(GLsizei capacity, GlState &glState)
+    : capacity(capacity), glState(glState) {
+   // Regions are bound as ranges, their offsets have to be aligned
+   GLint alignment = 1;
+   glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+   regionSize = capacity * sizeof(ObjectTransforms);
+   regionSize = (regionSize + alignment - 1) / alignment * alignment;
+
+   const GLbitfield flags =
+       GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+   glCreateBuffers(1, &buffer);
+   glNamedBufferStorage(buffer, regionSize * instanceBufferRegions, nullptr,
+                        flags);
+   mapped = static_cast<ObjectTransforms *>(glMapNamedBufferRange(
+       buffer, 0, regionSize * instanceBufferRegions, flags));
+}
+
+InstanceBuffer::~InstanceBuffer() {
+   for (GLsync fence : fences) {
+      if (fence)
+         glDeleteSync(fence);
+   }
+
+   glUnmapNamedBuffer(buffer);
+   glState.deleteBuffers(1, &buffer);
+}
+
+ObjectTransforms *InstanceBuffer::begin() {
+   region = (region + 1) % instanceBufferRegions;
+
+   // Usually signaled long ago, the GPU is at most a few frames behind
+   GLsync &fence = fences[region];
+   if (fence) {
+      GLenum status = GL_TIMEOUT_EXPIRED;
+      while (status == GL_TIMEOUT_EXPIRED)
+         status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                   1000000);
+      glDeleteSync(fence);
+      fence = nullptr;
+   }
+
+   const GLsizeiptr offset = regionSize * GLsizeiptr(region);
+   return reinterpret_cast<ObjectTransforms *>(
+       reinterpret_cast<char *>(mapped) + offset);
+}
+
+void InstanceBuffer::end(GLsizei count) {
+   this->count = std::min(count, capacity);
+
+   const GLsizeiptr offset = regionSize * GLsizeiptr(region);
+   glState.bindBufferRange(
+       GL_SHADER_STORAGE_BUFFER, instanceTransformBinding, buffer, offset,
+       std::max<GLsizeiptr>(this->count, 1) * sizeof(ObjectTransforms));
+}
+
+void InstanceBuffer::fence() {
+   if (fences[region])
+      glDeleteSync(fences[region]);
+   fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
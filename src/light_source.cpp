@@ -1,6 +1,10 @@
 #include "light_source.h"
 
-LightSource::LightSource(glm::vec3 Position) {
+// Project Libraries
+#include "gl_state.h"
+
+LightSource::LightSource(glm::vec3 Position, GlState &glState)
+    : glState(glState) {
    this->Position = Position;
 
    // Vertices for a cube
@@ -24,29 +28,27 @@ LightSource::LightSource(glm::vec3 Position) {
 }
 
 void LightSource::setup() {
-   // Generate buffers
-   glGenVertexArrays(1, &VAO);
-   glGenBuffers(1, &VBO);
-   glGenBuffers(1, &EBO);
-
-   // Bindings
-   glBindVertexArray(VAO);
-   glBindBuffer(GL_ARRAY_BUFFER, VBO);
-   glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat),
-                &vertices[0], GL_STATIC_DRAW);
-   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-   glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
-                &indices[0], GL_STATIC_DRAW);
+   // Generate buffers, filled without binding anything
+   glCreateVertexArrays(1, &VAO);
+   glCreateBuffers(1, &VBO);
+   glCreateBuffers(1, &EBO);
+
+   glNamedBufferData(VBO, vertices.size() * sizeof(GLfloat), &vertices[0],
+                     GL_STATIC_DRAW);
+   glNamedBufferData(EBO, indices.size() * sizeof(GLuint), &indices[0],
+                     GL_STATIC_DRAW);
 
    // Structure
-   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat),
-                         (void *)0);
-   glEnableVertexAttribArray(0);
+   glVertexArrayElementBuffer(VAO, EBO);
+   glVertexArrayVertexBuffer(VAO, 0, VBO, 0, 3 * sizeof(GLfloat));
+   glEnableVertexArrayAttrib(VAO, 0);
+   glVertexArrayAttribFormat(VAO, 0, 3, GL_FLOAT, GL_FALSE, 0);
+   glVertexArrayAttribBinding(VAO, 0, 0);
 }
 
 void LightSource::Draw() {
-   glBindVertexArray(VAO);
+   // Left bound, the next draw binds its own vertex array anyway
+   glState.bindVertexArray(VAO);
    glDrawElements(GL_TRIANGLES, static_cast<GLuint>(indices.size()),
                   GL_UNSIGNED_INT, 0);
-   glBindVertexArray(0);
 }
\ No newline at end of file
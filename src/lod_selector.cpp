@@ -0,0 +1,54 @@
+#include "lod_selector.h"
+
+// C++ Libraries
+#include <algorithm>
+#include <limits>
+
+void LodSelector::update(const glm::mat4 &projection, float viewportHeight) {
+   // projection[1][1] is cot(fov / 2) for perspective projections
+   pixelScale = projection[1][1] * viewportHeight * 0.5f;
+}
+
+/// Largest scale of model, bounding spheres grow by it
+static float maxScale(const glm::mat4 &model) {
+   return std::max({glm::length(glm::vec3(model[0])),
+                    glm::length(glm::vec3(model[1])),
+                    glm::length(glm::vec3(model[2]))});
+}
+
+/// Distance from viewPos to the bounding sphere of the mesh in world space
+static float sphereDistance(const Mesh &mesh, const glm::mat4 &model,
+                            float scale, const glm::vec3 &viewPos) {
+   const glm::vec3 center =
+       glm::vec3(model * glm::vec4(mesh.bounds.center, 1.0f));
+   return glm::length(center - viewPos) - mesh.bounds.radius * scale;
+}
+
+size_t LodSelector::select(const Mesh &mesh, const glm::mat4 &model,
+                           const glm::vec3 &viewPos) const {
+   if (mesh.lods.size() < 2)
+      return 0;
+
+   const float scale = maxScale(model);
+   const float distance = sphereDistance(mesh, model, scale, viewPos);
+   if (distance <= 0.0f)
+      return 0;
+
+   // Object space error to pixels at the nearest point of the sphere
+   const float pixelsPerUnit = pixelScale * scale / distance;
+
+   size_t lod = 0;
+   while (lod + 1 < mesh.lods.size() &&
+          mesh.lods[lod + 1].error * pixelsPerUnit <= pixelThreshold)
+      lod++;
+   return lod;
+}
+
+float LodSelector::projectedSize(const Mesh &mesh, const glm::mat4 &model,
+                                 const glm::vec3 &viewPos) const {
+   const float scale = maxScale(model);
+   const float distance = sphereDistance(mesh, model, scale, viewPos);
+   if (distance <= 0.0f)
+      return std::numeric_limits<float>::infinity();
+   return 2.0f * mesh.bounds.radius * scale * pixelScale / distance;
+}
@@ -1,86 +1,266 @@
-#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
 
 // Graphics Libraries
-#define STB_IMAGE_IMPLEMENTATION
-
 #include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 // Project Libraries
-#include "shader_pipeline.h"
-#include "light_source.h"
-#include "model.h"
 #include "camera.h"
 #include "debug.h"
-
-void debugMsg(std::string source, std::string error) {
-   std::cout << "[DEBUG] " << source << ": " << error << "\n" << std::flush;
+#include "headless_context.h"
+#include "image_writer.h"
+#include "profiler.h"
+#include "render_target.h"
+#include "viewer.h"
+
+/// Input and camera state of the window, reached from the GLFW callbacks
+/// through the window user pointer
+struct WindowState {
+   // Camera parameters
+   Camera camera;
+   float lastX, lastY;
+   float acceleration = 1.0;
+
+   bool firstMouse = false;
+
+   // Draw path, toggled with B unless instances are drawn
+   bool useBatch = false;
+   bool batchKeyDown = false;
+   bool batchAvailable = true;
+
+   // Picks the mesh in the middle of the screen when P is pressed
+   bool pickRequested = false;
+   bool pickKeyDown = false;
+
+   // Delta time
+   float deltaTime, lastTime = 0.0f;
+};
+
+static WindowState &getState(GLFWwindow *window) {
+   return *static_cast<WindowState *>(glfwGetWindowUserPointer(window));
 }
 
-// Window defines
-#define WINDOW_WIDTH 500
-#define WINDOW_HEIGHT 500
-
-// Camera parameters
-Camera camera;
-float lastX = float(WINDOW_WIDTH) / 2;
-float lastY = float(WINDOW_HEIGHT) / 2;
-float acceleration = 1.0;
-
-bool firstMouse = false;
-
-// Delta time
-float deltaTime, lastTime = 0.0f;
-
-// Light parameters
-
 void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
    glViewport(0, 0, width, height);
 }
 
 void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
-   if (firstMouse) {
-      lastX = xpos;
-      lastY = ypos;
-      firstMouse = false;
+   WindowState &state = getState(window);
+   if (state.firstMouse) {
+      state.lastX = xpos;
+      state.lastY = ypos;
+      state.firstMouse = false;
    }
 
-   float xoffset = xpos - lastX;
-   float yoffset = lastY - ypos;
-   lastX = xpos;
-   lastY = ypos;
+   float xoffset = xpos - state.lastX;
+   float yoffset = state.lastY - ypos;
+   state.lastX = xpos;
+   state.lastY = ypos;
 
-   camera.setDirection(xoffset, yoffset);
+   state.camera.setDirection(xoffset, yoffset);
 }
 
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
-   camera.setZoom((float)yoffset);
+   getState(window).camera.setZoom((float)yoffset);
 }
 
 void processInput(GLFWwindow *window) {
+   WindowState &state = getState(window);
    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
       glfwSetWindowShouldClose(window, true);
 
+   bool batchKey = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
+   if (batchKey && !state.batchKeyDown && state.batchAvailable)
+      state.useBatch = !state.useBatch;
+   state.batchKeyDown = batchKey;
+
+   bool pickKey = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+   if (pickKey && !state.pickKeyDown)
+      state.pickRequested = true;
+   state.pickKeyDown = pickKey;
+
    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) {
-      acceleration = 2.5f;
+      state.acceleration = 2.5f;
    } else {
-      acceleration = 1.0f;
+      state.acceleration = 1.0f;
    }
 
+   const float distance = state.deltaTime * state.acceleration;
    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-      camera.moveForward(deltaTime * acceleration);
+      state.camera.moveForward(distance);
    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-      camera.moveBackward(deltaTime * acceleration);
+      state.camera.moveBackward(distance);
    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-      camera.moveLeft(deltaTime * acceleration);
+      state.camera.moveLeft(distance);
    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-      camera.moveRight(deltaTime * acceleration);
+      state.camera.moveRight(distance);
 }
 
-int main(int argc, char **argv) {
+/// Reads the outstanding timer queries, logs the statistics and writes the
+/// trace. Needs the context to be current
+void writeProfile(const ViewerOptions &options) {
+   Profiler &profiler = getProfiler();
+   if (!profiler.isEnabled())
+      return;
+
+   profiler.finish();
+   profiler.report();
+   profiler.writeTrace(options.profilePath);
+}
+
+/// File name pattern of dumped frames, split around its frame number
+struct DumpPattern {
+   std::string prefix, suffix;
+   int digits = 0;
+};
+
+/// Accepts patterns with exactly one %d or %0Nd and no other conversion,
+/// the path comes from the command line and is never used as a format
+static bool parseDumpPath(const std::string &path, DumpPattern &pattern) {
+   const size_t start = path.find('%');
+   if (start == std::string::npos)
+      return false;
+
+   size_t end = start + 1;
+   int digits = 0;
+   if (end < path.size() && path[end] == '0') {
+      // At most three digits of zero padding
+      const size_t first = ++end;
+      while (end < path.size() && std::isdigit((unsigned char)path[end]))
+         end++;
+      if (end == first || end - first > 3)
+         return false;
+      digits = std::atoi(path.substr(first, end - first).c_str());
+   }
+   if (end >= path.size() || path[end] != 'd' ||
+       path.find('%', end) != std::string::npos)
+      return false;
+
+   pattern.prefix = path.substr(0, start);
+   pattern.suffix = path.substr(end + 1);
+   pattern.digits = digits;
+   return true;
+}
+
+/// Renders options.frames frames along an orbit around the model into an
+/// offscreen target, then reports the frame times
+int runHeadless(const ViewerOptions &options) {
+   DumpPattern dumpPattern;
+   if (!options.dumpFrames.empty() &&
+       !parseDumpPath(options.dumpPath, dumpPattern)) {
+      debugMsg("Headless", "Dump path " + options.dumpPath +
+                               " needs exactly one %d or %0Nd");
+      return -4;
+   }
+
+   HeadlessContext context;
+   if (!context.isValid())
+      return -1;
+
+   RenderTarget target(options.width, options.height);
+   if (!target.isComplete()) {
+      debugMsg("Headless", "Incomplete render target");
+      return -3;
+   }
+
+   std::vector<double> timings;
+   {
+      Viewer viewer(options);
+
+      // Frame times should not include the textures still streaming in
+      TextureLoader &textureLoader = viewer.getTextureLoader();
+      while (!textureLoader.idle()) {
+         if (textureLoader.upload() == 0)
+            std::this_thread::yield();
+      }
+
+      // Orbit at a distance that fits the bounding sphere into the view
+      const Aabb bounds = viewer.getModel().getBounds();
+      const glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+      const float radius = glm::length(bounds.max - bounds.min) * 0.5f;
+      const float distance =
+          std::max(radius / std::sin(glm::radians(22.5f)), 0.5f);
+
+      Camera camera;
+      target.bind();
+      std::vector<uint8_t> pixels;
+      char path[4096];
+      for (int frame = 0; frame < options.frames; frame++) {
+         const float angle = glm::two_pi<float>() * frame / options.frames;
+         camera.Position =
+             center + glm::vec3(std::sin(angle) * distance, radius * 0.5f,
+                                std::cos(angle) * distance);
+         camera.setTarget(center);
+
+         // glFinish makes the time cover the GPU work of the frame
+         const auto start = std::chrono::steady_clock::now();
+         {
+            getProfiler().beginFrame();
+            ProfileScope scope("Frame");
+            viewer.renderFrame(camera, options.width, options.height,
+                               options.batch);
+            glFinish();
+         }
+         const std::chrono::duration<double, std::milli> elapsed =
+             std::chrono::steady_clock::now() - start;
+         timings.push_back(elapsed.count());
+
+         if (std::find(options.dumpFrames.begin(), options.dumpFrames.end(),
+                       frame) != options.dumpFrames.end()) {
+            target.readPixels(pixels);
+            const int length = std::snprintf(
+                path, sizeof(path), "%s%0*d%s", dumpPattern.prefix.c_str(),
+                dumpPattern.digits, frame, dumpPattern.suffix.c_str());
+            if (length < 0 || size_t(length) >= sizeof(path))
+               debugMsg("Headless", "Dump path too long");
+            else
+               writeImage(path, options.width, options.height, pixels);
+         }
+      }
+      writeProfile(options);
+      viewer.getRenderQueue().report();
+      viewer.getGlState().report();
+      viewer.getTextureCache().report();
+   }
+
+   if (timings.empty())
+      return 0;
+
+   if (!options.timingsPath.empty()) {
+      std::ofstream file(options.timingsPath);
+      file << "frame,milliseconds\n";
+      for (size_t i = 0; i < timings.size(); i++)
+         file << i << "," << timings[i] << "\n";
+      if (!file)
+         debugMsg("Headless", "Could not write " + options.timingsPath);
+   }
+
+   double total = 0.0;
+   for (double timing : timings)
+      total += timing;
+   std::ostringstream summary;
+   summary << timings.size() << " frames at " << options.width << "x"
+           << options.height << ", min "
+           << *std::min_element(timings.begin(), timings.end()) << " ms, avg "
+           << total / timings.size() << " ms, max "
+           << *std::max_element(timings.begin(), timings.end()) << " ms";
+   debugMsg("Headless", summary.str());
+   return 0;
+}
+
+int runWindow(const ViewerOptions &options) {
    // --- Initialize GLFW for use with OpenGL 4.5 ---
    glfwInit();
    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
@@ -88,8 +268,8 @@ int main(int argc, char **argv) {
    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
    // Create window
-   GLFWwindow *window =
-       glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "3d.view", NULL, NULL);
+   GLFWwindow *window = glfwCreateWindow(options.width, options.height,
+                                         "3d.view", NULL, NULL);
 
    if (window == NULL) {
       debugMsg("GLFW", "Failed to create window");
@@ -97,7 +277,14 @@ int main(int argc, char **argv) {
       return -1;
    }
 
+   WindowState state;
+   state.lastX = float(options.width) / 2;
+   state.lastY = float(options.height) / 2;
+   state.useBatch = options.batch;
+   state.batchAvailable = options.instanceGrid == 0;
+
    glfwMakeContextCurrent(window);
+   glfwSetWindowUserPointer(window, &state);
    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
    glfwSetCursorPosCallback(window, mouse_callback);
@@ -110,28 +297,12 @@ int main(int argc, char **argv) {
    }
 
    // Setup viewport
-   glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+   glViewport(0, 0, options.width, options.height);
 
-   // stbi parameters
-   stbi_set_flip_vertically_on_load(true);
-
-   // --- Create shader programs ---
-   ShaderPaths modelPaths = {"src/shaders/modelShader.vert",
-                             "src/shaders/modelShader.frag"};
-   ShaderPipeline *modelPipeline = new ShaderPipeline(modelPaths);
-
-   ShaderPaths lightPaths = {"src/shaders/simpleShader.vert",
-                             "src/shaders/simpleShader.frag"};
-   ShaderPipeline *lightPipeline = new ShaderPipeline(lightPaths);
-
-   // Create lamp
-   LightSource lamp(glm::vec3(1.2f, 1.0f, 2.0f));
-
-   // Load model
-   Model loadedModel("assets/wood/wood.obj");
-
-   // --- Enable depth ---
-   glEnable(GL_DEPTH_TEST);
+   // Load model, keep handling window events while the workers import it.
+   // The viewer holds GL objects and has to go before glfwTerminate
+   Viewer *viewer =
+       new Viewer(options, [](size_t, size_t) { glfwPollEvents(); });
 
    // --- GLFW window loop ---
    while (!glfwWindowShouldClose(window)) {
@@ -139,61 +310,97 @@ int main(int argc, char **argv) {
       processInput(window);
 
       float currentTime = glfwGetTime();
-      deltaTime = currentTime - lastTime;
-      lastTime = currentTime;
-
-      // Clear window buffer
-      glClearColor(0.01f, 0.01f, 0.01f, 1.0f);
-      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-      // Enable shader program
-      (*modelPipeline).use();
-      (*modelPipeline).setVec3("light.color", glm::value_ptr(lamp.Color));
-      (*modelPipeline)
-          .setVec3("light.ambient", glm::value_ptr(lamp.AmbientStrength));
-      (*modelPipeline)
-          .setVec3("light.specular", glm::value_ptr(lamp.SpecularStrength));
-
-      (*modelPipeline).setVec3("lightPos", glm::value_ptr(lamp.Position));
-      (*modelPipeline).setVec3("viewPos", glm::value_ptr(camera.Position));
-
-      // Transformations
-      glm::mat4 model = glm::mat4(1.0f);
-      model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
-      model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-      (*modelPipeline).setMat4("model", glm::value_ptr(model));
-      (*modelPipeline).setMat4("view", glm::value_ptr(camera.getView()));
-      (*modelPipeline)
-          .setMat4("projection", glm::value_ptr(camera.getProjection(
-                                     (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT,
-                                     0.1f, 100.0f)));
-
-      loadedModel.Draw(*modelPipeline);
-
-      // Same but for light
-      (*lightPipeline).use();
-      model = glm::mat4(1.0f);
-      model = glm::translate(model, lamp.Position);
-      model = glm::scale(model, glm::vec3(0.2f));
-      (*lightPipeline).setMat4("model", glm::value_ptr(model));
-      (*lightPipeline).setMat4("view", glm::value_ptr(camera.getView()));
-      (*lightPipeline)
-          .setMat4("projection", glm::value_ptr(camera.getProjection(
-                                     (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT,
-                                     0.1f, 100.0f)));
-      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-      lamp.Draw();
-      glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+      state.deltaTime = currentTime - state.lastTime;
+      state.lastTime = currentTime;
+
+      int width, height;
+      glfwGetFramebufferSize(window, &width, &height);
+      const float aspect = float(width) / float(std::max(height, 1));
+
+      getProfiler().beginFrame();
+      ProfileScope scope("Frame");
+      (*viewer).renderFrame(state.camera, width, height, state.useBatch);
+
+      if (state.pickRequested) {
+         (*viewer).pick(state.camera, aspect);
+         state.pickRequested = false;
+      }
 
       glfwSwapBuffers(window);
       glfwPollEvents();
    }
 
+   writeProfile(options);
+
    // GL deallocation
-   delete modelPipeline;
-   delete lightPipeline;
+   delete viewer;
 
    // Program termination
    glfwTerminate();
    return 0;
 }
+
+int main(int argc, char **argv) {
+   // --packed selects the quantized vertices, --instances N draws an N x N
+   // grid of copies of the model and --headless renders offscreen
+   ViewerOptions options;
+   for (int i = 1; i < argc; i++) {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+      if (arg == "--packed") {
+         options.vertexFormat = VertexFormat::Packed;
+      } else if (arg == "--batch") {
+         options.batch = true;
+      } else if (arg == "--uncompressed") {
+         options.compressTextures = false;
+      } else if (arg == "--gamma") {
+         options.gammaCorrection = true;
+      } else if (arg == "--texture-budget" && hasValue) {
+         // Mebibytes
+         options.textureBudget =
+             size_t(std::max(std::atoi(argv[++i]), 0)) * 1024 * 1024;
+      } else if (arg == "--instances" && hasValue) {
+         options.instanceGrid = std::max(std::atoi(argv[++i]), 0);
+      } else if (arg == "--model" && hasValue) {
+         options.modelPath = argv[++i];
+      } else if (arg == "--size" && hasValue) {
+         int width, height;
+         if (std::sscanf(argv[++i], "%dx%d", &width, &height) == 2 &&
+             width > 0 && height > 0) {
+            options.width = width;
+            options.height = height;
+         }
+      } else if (arg == "--headless") {
+         options.headless = true;
+      } else if (arg == "--frames" && hasValue) {
+         options.frames = std::max(std::atoi(argv[++i]), 0);
+      } else if (arg == "--dump" && hasValue) {
+         // Comma separated frame numbers
+         std::istringstream frames(argv[++i]);
+         std::string frame;
+         while (std::getline(frames, frame, ','))
+            options.dumpFrames.push_back(std::atoi(frame.c_str()));
+      } else if (arg == "--dump-path" && hasValue) {
+         options.dumpPath = argv[++i];
+      } else if (arg == "--timings" && hasValue) {
+         options.timingsPath = argv[++i];
+      } else if (arg == "--profile" && hasValue) {
+         options.profilePath = argv[++i];
+      } else {
+         debugMsg("Arguments", "Unknown option " + arg);
+      }
+   }
+
+   // The batch draws every mesh once from its own buffers
+   if (options.batch && options.instanceGrid > 0) {
+      debugMsg("Arguments", "--batch cannot draw --instances");
+      return -1;
+   }
+
+   // Enabled before the viewer is created, so that the import is included
+   getProfiler().setEnabled(!options.profilePath.empty());
+
+   if (options.headless)
+      return runHeadless(options);
+   return runWindow(options);
+}
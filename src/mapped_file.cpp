@@ -0,0 +1,67 @@
+#include "mapped_file.h"
+
+// POSIX Libraries
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// C++ Libraries
+#include <cstring>
+
+bool MappedFile::open(const std::string &path, bool sequential) {
+   close();
+
+   int fd = ::open(path.c_str(), O_RDONLY);
+   if (fd < 0)
+      return false;
+
+   struct stat info;
+   if (fstat(fd, &info) != 0 || info.st_size == 0) {
+      ::close(fd);
+      return false;
+   }
+
+   void *address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   ::close(fd);
+   if (address == MAP_FAILED)
+      return false;
+
+   // Ask the kernel to read ahead, the data is consumed front to back
+   if (sequential) {
+      madvise(address, info.st_size, MADV_SEQUENTIAL);
+      madvise(address, info.st_size, MADV_WILLNEED);
+   }
+
+   mapping = address;
+   length = info.st_size;
+   return true;
+}
+
+void MappedFile::close() {
+   if (mapping)
+      munmap(mapping, length);
+
+   mapping = nullptr;
+   length = 0;
+}
+
+uint64_t hashBytes(const uint8_t *data, size_t size, uint64_t seed) {
+   const uint64_t prime = 0x100000001b3ull;
+   uint64_t hash = 0xcbf29ce484222325ull ^ seed;
+
+   // FNV-1a over 64-bit words with an extra mix, bytes for the tail
+   size_t i = 0;
+   for (; i + 8 <= size; i += 8) {
+      uint64_t word;
+      std::memcpy(&word, data + i, 8);
+      hash = (hash ^ word) * prime;
+      hash ^= hash >> 29;
+   }
+   for (; i < size; i++)
+      hash = (hash ^ data[i]) * prime;
+
+   hash ^= size;
+   hash *= prime;
+   return hash ^ (hash >> 32);
+}
@@ -0,0 +1,155 @@
+#include "material_system.h"
+
+// C++ Libraries
+#include <algorithm>
+
+// Project Libraries
+#include "gl_state.h"
+
+bool MaterialArrays::operator==(const MaterialArrays &other) const {
+   return std::equal(textures, textures + materialSlots, other.textures);
+}
+
+bool MaterialArrays::operator<(const MaterialArrays &other) const {
+   return std::lexicographical_compare(textures, textures + materialSlots,
+                                       other.textures,
+                                       other.textures + materialSlots);
+}
+
+/// Slot a map of this type is sampled through, -1 for unused types
+static int materialSlot(const std::string &type) {
+   if (type == "texture_diffuse")
+      return SLOT_DIFFUSE;
+   if (type == "texture_specular")
+      return SLOT_SPECULAR;
+   if (type == "texture_normal")
+      return SLOT_NORMAL;
+   return -1;
+}
+
+/// Diffuse maps are sRGB colors, specular maps are masks
+static TextureKind slotKind(int slot) {
+   if (slot == SLOT_NORMAL)
+      return TextureKind::Normal;
+   return slot == SLOT_DIFFUSE ? TextureKind::Color : TextureKind::Linear;
+}
+
+MaterialSystem::MaterialSystem(TextureCache &textureCache, GlState &glState,
+                               bool gammaCorrection)
+    : textureCache(textureCache), glState(glState),
+      gammaCorrection(gammaCorrection) {
+   listener = textureCache.addListener(
+       [this](TextureHandle texture) { resident(texture); });
+}
+
+MaterialSystem::~MaterialSystem() {
+   textureCache.removeListener(listener);
+   for (const Material &material : materials) {
+      for (TextureHandle texture : material.textures) {
+         if (texture != noTexture)
+            textureCache.release(texture);
+      }
+   }
+   glState.deleteBuffers(1, &recordBuffer);
+}
+
+GLuint MaterialSystem::addMaterial(const std::vector<TextureRef> &refs,
+                                   const std::string &directory) {
+   // The shaders sample the first map of every slot
+   Material material;
+   std::fill_n(material.textures, materialSlots, noTexture);
+   for (const TextureRef &ref : refs) {
+      const int slot = materialSlot(ref.type);
+      if (slot >= 0 && material.textures[slot] == noTexture)
+         material.textures[slot] = textureCache.acquire(
+             directory + '/' + ref.path, slotKind(slot),
+             gammaCorrection && slot == SLOT_DIFFUSE);
+   }
+
+   // Paths of the cache are canonical, equal maps have equal handles
+   for (size_t i = 0; i < materials.size(); i++) {
+      if (std::equal(material.textures, material.textures + materialSlots,
+                     materials[i].textures)) {
+         for (TextureHandle texture : material.textures) {
+            if (texture != noTexture)
+               textureCache.release(texture);
+         }
+         return static_cast<GLuint>(i);
+      }
+   }
+
+   const GLuint index = static_cast<GLuint>(materials.size());
+   materials.push_back(material);
+   records.push_back({});
+   for (TextureHandle texture : material.textures) {
+      if (texture != noTexture)
+         users[texture].push_back(index);
+   }
+
+   // Maps another model uploaded before are already resident
+   updateRecord(index);
+   return index;
+}
+
+void MaterialSystem::bind() const {
+   glState.bindBufferBase(GL_SHADER_STORAGE_BUFFER, materialRecordBinding,
+                          recordBuffer);
+}
+
+void MaterialSystem::request(GLuint material, float pixels) const {
+   for (TextureHandle texture : materials[material].textures) {
+      if (texture != noTexture)
+         textureCache.request(texture, pixels);
+   }
+}
+
+MaterialArrays MaterialSystem::getArrays(GLuint material) const {
+   MaterialArrays result;
+   for (GLuint slot = 0; slot < materialSlots; slot++) {
+      const TextureHandle texture = materials[material].textures[slot];
+      if (texture != noTexture)
+         result.textures[slot] = textureCache.getArray(texture);
+   }
+   return result;
+}
+
+/// --- Records ---
+void MaterialSystem::resident(TextureHandle texture) {
+   const auto found = users.find(texture);
+   if (found != users.end()) {
+      for (GLuint material : found->second)
+         updateRecord(material);
+   }
+
+   // Arrays of maps of other models may have moved as well
+   generation++;
+}
+
+void MaterialSystem::updateRecord(GLuint material) {
+   MaterialRecord &record = records[material];
+   record = {};
+   for (GLuint slot = 0; slot < materialSlots; slot++) {
+      const TextureHandle texture = materials[material].textures[slot];
+      if (texture != noTexture && textureCache.getArray(texture)) {
+         record.flags |= 1u << slot;
+         record.layers[slot] = textureCache.getLayer(texture);
+      }
+   }
+
+   // Grown by doubling, the whole mirror is written when it moves
+   if (records.size() > recordCapacity) {
+      recordCapacity = std::max<size_t>(recordCapacity * 2, 16);
+      glState.deleteBuffers(1, &recordBuffer);
+      glCreateBuffers(1, &recordBuffer);
+      glNamedBufferStorage(recordBuffer,
+                           recordCapacity * sizeof(MaterialRecord), nullptr,
+                           GL_DYNAMIC_STORAGE_BIT);
+      glNamedBufferSubData(recordBuffer, 0,
+                           records.size() * sizeof(MaterialRecord),
+                           records.data());
+      return;
+   }
+
+   glNamedBufferSubData(recordBuffer, material * sizeof(MaterialRecord),
+                        sizeof(MaterialRecord), &record);
+}
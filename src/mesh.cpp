@@ -1,74 +1,86 @@
 #include "mesh.h"
 
-Mesh::Mesh(std::vector<Vertex> &vertices, std::vector<GLuint> &indices,
-           std::vector<Texture> &textures) {
-   this->vertices = vertices;
-   this->indices = indices;
-   this->textures = textures;
+// C++ Libraries
+#include <algorithm>
+#include <cmath>
 
-   setup();
-}
-
-void Mesh::setup() {
-   // Generate buffers
-   glGenVertexArrays(1, &VAO);
-   glGenBuffers(1, &VBO);
-   glGenBuffers(1, &EBO);
+MeshBounds computeBounds(const Vertex *vertices, size_t count) {
+   MeshBounds bounds;
+   if (count == 0)
+      return bounds;
 
-   // Bindings
-   glBindVertexArray(VAO);
-   glBindBuffer(GL_ARRAY_BUFFER, VBO);
-   glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0],
-                GL_STATIC_DRAW);
-   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-   glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
-                &indices[0], GL_STATIC_DRAW);
+   bounds.min = bounds.max = vertices[0].Position;
+   for (size_t i = 1; i < count; i++) {
+      bounds.min = glm::min(bounds.min, vertices[i].Position);
+      bounds.max = glm::max(bounds.max, vertices[i].Position);
+   }
 
-   // Vertex structure
-   // | Pos | Ind | Tex | Tng | Bng |
-   // |  0  |  1  |  2  |  3  |  4  |
-   glEnableVertexAttribArray(0);
-   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
-   glEnableVertexAttribArray(1);
-   glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                         (void *)offsetof(Vertex, Normal));
-   glEnableVertexAttribArray(2);
-   glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                         (void *)offsetof(Vertex, TexCoords));
-   glEnableVertexAttribArray(3);
-   glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                         (void *)offsetof(Vertex, Tangent));
-   glEnableVertexAttribArray(4);
-   glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                         (void *)offsetof(Vertex, Bitangent));
+   // Centered on the box, a little looser than the minimal sphere
+   bounds.center = (bounds.min + bounds.max) * 0.5f;
+   float radiusSquared = 0.0f;
+   for (size_t i = 0; i < count; i++) {
+      const glm::vec3 offset = vertices[i].Position - bounds.center;
+      radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+   }
+   bounds.radius = std::sqrt(radiusSquared);
 
-   glBindVertexArray(0);
+   return bounds;
 }
 
-void Mesh::Draw(ShaderPipeline &shaderPipeline) {
-   unsigned int diffuseNr = 1;
-   unsigned int specularNr = 1;
-   unsigned int normalNr = 1;
+Mesh::Mesh(const MeshView &view, GLuint material, VertexFormat format) {
+   this->vertexCount = static_cast<GLsizei>(view.vertexCount);
+   this->indexCount = static_cast<GLsizei>(view.indexCount);
+   this->material = material;
+   this->format = format;
+   this->bounds = view.bounds;
+
+   // Meshes without levels draw their whole index buffer
+   this->lods = view.lods;
+   if (lods.empty())
+      lods.push_back({0, static_cast<uint32_t>(view.indexCount), 0.0f});
 
-   for (unsigned int i = 0; i < textures.size(); i++) {
-      glActiveTexture(GL_TEXTURE0 + i);
-      std::string number;
-      std::string name = textures[i].type;
-      if (name == "texture_diffuse")
-         number = std::to_string(diffuseNr++);
-      else if (name == "texture_specular")
-         number = std::to_string(specularNr++);
-      else if (name == "texture_normal")
-         number = std::to_string(normalNr++);
+   setup(view);
+}
 
-      shaderPipeline.setInt(("material." + name + number).c_str(), i);
-      glBindTexture(GL_TEXTURE_2D, textures[i].id);
+void Mesh::setup(const MeshView &view) {
+   // Generate buffers, filled without binding anything
+   glCreateVertexArrays(1, &VAO);
+   glCreateBuffers(1, &VBO);
+   glCreateBuffers(1, &EBO);
+
+   if (format == VertexFormat::Packed) {
+      std::vector<PackedVertex> packed = packVertices(
+          view.vertices, view.vertexCount, bounds.min, bounds.max - bounds.min);
+      glNamedBufferData(VBO, packed.size() * sizeof(PackedVertex),
+                        packed.data(), GL_STATIC_DRAW);
+   } else {
+      glNamedBufferData(VBO, view.vertexCount * sizeof(Vertex), view.vertices,
+                        GL_STATIC_DRAW);
    }
+   glNamedBufferData(EBO, view.indexCount * sizeof(GLuint), view.indices,
+                     GL_STATIC_DRAW);
+
+   // Vertex structure, see vertex_format.h
+   glVertexArrayElementBuffer(VAO, EBO);
+   glVertexArrayVertexBuffer(VAO, 0, VBO, 0, vertexStride(format));
+   vertexAttributes(VAO, 0, format);
+}
 
-   glBindVertexArray(VAO);
-   glDrawElements(GL_TRIANGLES, static_cast<GLuint>(indices.size()),
-                  GL_UNSIGNED_INT, 0);
-   glBindVertexArray(0);
+void Mesh::submit(const ShaderPipeline &shaderPipeline, size_t lod,
+                  GLsizei instanceCount) const {
+   if (format == VertexFormat::Packed) {
+      static constexpr UniformID boundsMinID = uniformID("meshBoundsMin");
+      static constexpr UniformID boundsExtentID = uniformID("meshBoundsExtent");
+
+      const glm::vec3 extent = bounds.max - bounds.min;
+      shaderPipeline.setVec3(shaderPipeline.getUniform(boundsMinID),
+                             &bounds.min[0]);
+      shaderPipeline.setVec3(shaderPipeline.getUniform(boundsExtentID),
+                             &extent[0]);
+   }
 
-   glActiveTexture(GL_TEXTURE0);
+   const MeshLod &level = lods[lod];
+   glDrawElementsInstanced(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_INT,
+                           (void *)(level.indexOffset * sizeof(GLuint)),
+                           instanceCount);
 }
\ No newline at end of file
@@ -0,0 +1,249 @@
+#include "mesh_cache.h"
+
+// C++ Libraries
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+static size_t alignTo(size_t offset, size_t alignment) {
+   return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+bool MeshCache::hashSource(const std::string &sourcePath, uint64_t &hash) {
+   MappedFile source;
+   if (!source.open(sourcePath))
+      return false;
+
+   hash = hashBytes(source.data(), source.size());
+   return true;
+}
+
+bool MeshCache::open(const std::string &sourcePath, uint32_t importFlags) {
+   views.clear();
+   drawOrder.clear();
+   file.close();
+
+   uint64_t sourceHash;
+   if (!hashSource(sourcePath, sourceHash) ||
+       !file.open(cachePath(sourcePath)))
+      return false;
+
+   const uint8_t *base = file.data();
+   const size_t size = file.size();
+
+   // Header
+   MeshCacheHeader header;
+   if (size < sizeof(header)) {
+      file.close();
+      return false;
+   }
+   std::memcpy(&header, base, sizeof(header));
+
+   if (std::memcmp(header.magic, "3DVC", 4) != 0 ||
+       header.version != meshCacheVersion ||
+       header.sourceHash != sourceHash ||
+       header.importFlags != importFlags ||
+       header.vertexSize != sizeof(Vertex)) {
+      file.close();
+      return false;
+   }
+
+   // Tables
+   const size_t recordsOffset = sizeof(MeshCacheHeader);
+   const size_t orderOffset =
+       recordsOffset + size_t(header.meshCount) * sizeof(MeshCacheRecord);
+   const size_t texturesOffset =
+       orderOffset + size_t(header.orderCount) * sizeof(uint32_t);
+   const size_t lodsOffset =
+       texturesOffset + size_t(header.textureCount) * sizeof(MeshCacheTexture);
+   const size_t stringsOffset =
+       lodsOffset + size_t(header.lodCount) * sizeof(MeshLod);
+   if (stringsOffset + header.stringsSize > size) {
+      debugMsg("MeshCache", "Truncated cache " + cachePath(sourcePath));
+      file.close();
+      return false;
+   }
+
+   const auto *records =
+       reinterpret_cast<const MeshCacheRecord *>(base + recordsOffset);
+   const auto *order = reinterpret_cast<const uint32_t *>(base + orderOffset);
+   const auto *textures =
+       reinterpret_cast<const MeshCacheTexture *>(base + texturesOffset);
+   const auto *lods = reinterpret_cast<const MeshLod *>(base + lodsOffset);
+   const char *strings = reinterpret_cast<const char *>(base + stringsOffset);
+
+   // Meshes, every range is validated before it is handed out
+   bool valid = true;
+   views.resize(header.meshCount);
+   for (uint32_t i = 0; i < header.meshCount && valid; i++) {
+      const MeshCacheRecord &record = records[i];
+      valid = record.vertexOffset <= size &&
+              record.vertexCount <=
+                  (size - record.vertexOffset) / sizeof(Vertex) &&
+              record.indexOffset <= size &&
+              record.indexCount <=
+                  (size - record.indexOffset) / sizeof(GLuint) &&
+              record.firstTexture <= header.textureCount &&
+              record.textureCount <=
+                  header.textureCount - record.firstTexture &&
+              record.firstLod <= header.lodCount &&
+              record.lodCount <= header.lodCount - record.firstLod;
+      if (!valid)
+         break;
+
+      MeshView &view = views[i];
+      view.vertices =
+          reinterpret_cast<const Vertex *>(base + record.vertexOffset);
+      view.vertexCount = record.vertexCount;
+      view.indices = reinterpret_cast<const GLuint *>(base + record.indexOffset);
+      view.indexCount = record.indexCount;
+      view.bounds = record.bounds;
+
+      for (uint32_t j = 0; j < record.lodCount && valid; j++) {
+         const MeshLod &lod = lods[record.firstLod + j];
+         valid = lod.indexOffset <= record.indexCount &&
+                 lod.indexCount <= record.indexCount - lod.indexOffset;
+         view.lods.push_back(lod);
+      }
+
+      for (uint32_t j = 0; j < record.textureCount; j++) {
+         const MeshCacheTexture &texture = textures[record.firstTexture + j];
+         if (texture.typeOffset + size_t(texture.typeLength) >
+                 header.stringsSize ||
+             texture.pathOffset + size_t(texture.pathLength) >
+                 header.stringsSize) {
+            valid = false;
+            break;
+         }
+         view.textures.push_back(
+             {std::string(strings + texture.typeOffset, texture.typeLength),
+              std::string(strings + texture.pathOffset, texture.pathLength)});
+      }
+   }
+
+   drawOrder.assign(order, order + header.orderCount);
+   for (uint32_t index : drawOrder)
+      valid = valid && index < header.meshCount;
+
+   if (!valid) {
+      debugMsg("MeshCache", "Corrupt cache " + cachePath(sourcePath));
+      views.clear();
+      drawOrder.clear();
+      file.close();
+      return false;
+   }
+
+   return true;
+}
+
+bool MeshCache::write(const std::string &sourcePath, uint32_t importFlags,
+                      const std::vector<MeshData> &meshes,
+                      const std::vector<uint32_t> &order) {
+   MeshCacheHeader header = {};
+   std::memcpy(header.magic, "3DVC", 4);
+   header.version = meshCacheVersion;
+   header.importFlags = importFlags;
+   header.vertexSize = sizeof(Vertex);
+   header.meshCount = static_cast<uint32_t>(meshes.size());
+   header.orderCount = static_cast<uint32_t>(order.size());
+   if (!hashSource(sourcePath, header.sourceHash))
+      return false;
+
+   // Texture references and their strings
+   std::vector<MeshCacheTexture> textures;
+   std::string strings;
+   for (const MeshData &mesh : meshes) {
+      for (const TextureRef &ref : mesh.textures) {
+         MeshCacheTexture texture;
+         texture.typeOffset = static_cast<uint32_t>(strings.size());
+         texture.typeLength = static_cast<uint32_t>(ref.type.size());
+         strings += ref.type;
+         texture.pathOffset = static_cast<uint32_t>(strings.size());
+         texture.pathLength = static_cast<uint32_t>(ref.path.size());
+         strings += ref.path;
+         textures.push_back(texture);
+      }
+   }
+   header.textureCount = static_cast<uint32_t>(textures.size());
+
+   // Levels of detail
+   std::vector<MeshLod> lods;
+   for (const MeshData &mesh : meshes)
+      lods.insert(lods.end(), mesh.lods.begin(), mesh.lods.end());
+   header.lodCount = static_cast<uint32_t>(lods.size());
+   header.stringsSize = static_cast<uint32_t>(strings.size());
+
+   // Lay out the data section
+   size_t offset = sizeof(MeshCacheHeader) +
+                   meshes.size() * sizeof(MeshCacheRecord) +
+                   order.size() * sizeof(uint32_t) +
+                   textures.size() * sizeof(MeshCacheTexture) +
+                   lods.size() * sizeof(MeshLod) + strings.size();
+
+   std::vector<MeshCacheRecord> records(meshes.size());
+   uint32_t firstTexture = 0;
+   uint32_t firstLod = 0;
+   for (size_t i = 0; i < meshes.size(); i++) {
+      MeshCacheRecord &record = records[i];
+      record.vertexOffset = offset = alignTo(offset, 16);
+      record.vertexCount = meshes[i].vertices.size();
+      offset += record.vertexCount * sizeof(Vertex);
+
+      record.indexOffset = offset = alignTo(offset, 16);
+      record.indexCount = meshes[i].indices.size();
+      offset += record.indexCount * sizeof(GLuint);
+
+      record.firstTexture = firstTexture;
+      record.textureCount = static_cast<uint32_t>(meshes[i].textures.size());
+      firstTexture += record.textureCount;
+
+      record.firstLod = firstLod;
+      record.lodCount = static_cast<uint32_t>(meshes[i].lods.size());
+      firstLod += record.lodCount;
+
+      record.bounds = meshes[i].bounds;
+   }
+
+   // Write to a temporary file first so readers never see a partial cache
+   const std::string path = cachePath(sourcePath);
+   const std::string temporary = path + ".tmp";
+   std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+   if (!stream.is_open()) {
+      debugMsg("MeshCache", "Failed to create " + temporary);
+      return false;
+   }
+
+   size_t written = 0;
+   auto put = [&stream, &written](const void *data, size_t size) {
+      stream.write(static_cast<const char *>(data), size);
+      written += size;
+   };
+   auto pad = [&stream, &written](size_t target) {
+      static const char zeros[16] = {};
+      stream.write(zeros, target - written);
+      written = target;
+   };
+
+   put(&header, sizeof(header));
+   put(records.data(), records.size() * sizeof(MeshCacheRecord));
+   put(order.data(), order.size() * sizeof(uint32_t));
+   put(textures.data(), textures.size() * sizeof(MeshCacheTexture));
+   put(lods.data(), lods.size() * sizeof(MeshLod));
+   put(strings.data(), strings.size());
+
+   for (size_t i = 0; i < meshes.size(); i++) {
+      pad(records[i].vertexOffset);
+      put(meshes[i].vertices.data(), meshes[i].vertices.size() * sizeof(Vertex));
+      pad(records[i].indexOffset);
+      put(meshes[i].indices.data(), meshes[i].indices.size() * sizeof(GLuint));
+   }
+
+   stream.close();
+   if (stream.fail() || std::rename(temporary.c_str(), path.c_str()) != 0) {
+      debugMsg("MeshCache", "Failed to write " + path);
+      std::remove(temporary.c_str());
+      return false;
+   }
+
+   return true;
+}
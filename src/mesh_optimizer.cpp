@@ -0,0 +1,292 @@
+#include "mesh_optimizer.h"
+
+// C++ Libraries
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/// --- Analysis ---
+VertexCacheStats analyzeVertexCache(const std::vector<GLuint> &indices,
+                                    size_t vertexCount, size_t cacheSize) {
+   VertexCacheStats stats;
+   const size_t triangleCount = indices.size() / 3;
+   if (triangleCount == 0 || vertexCount == 0)
+      return stats;
+
+   // FIFO cache, a vertex is cached while its insertion stamp is recent
+   std::vector<size_t> stamps(vertexCount, 0);
+   size_t timestamp = cacheSize + 1;
+   size_t misses = 0;
+
+   for (GLuint index : indices) {
+      if (timestamp - stamps[index] > cacheSize) {
+         stamps[index] = timestamp++;
+         misses++;
+      }
+   }
+
+   // Only referenced vertices count towards the transform ratio
+   size_t referenced = 0;
+   for (size_t stamp : stamps)
+      referenced += stamp != 0;
+
+   stats.acmr = float(misses) / float(triangleCount);
+   stats.atvr = float(misses) / float(referenced);
+   return stats;
+}
+
+/// --- Vertex Cache ---
+// Tuned constants from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+static const size_t forsythCacheSize = 32;
+
+static float vertexScore(int cachePosition, uint32_t liveTriangles) {
+   if (liveTriangles == 0)
+      return -1.0f;
+
+   float score = 0.0f;
+   if (cachePosition >= 0) {
+      if (cachePosition < 3) {
+         // The last triangle's vertices, fixed score to avoid reusing them
+         score = 0.75f;
+      } else {
+         const float scale = 1.0f / (forsythCacheSize - 3);
+         score = std::pow(1.0f - (cachePosition - 3) * scale, 1.5f);
+      }
+   }
+
+   // Favour vertices with few triangles left, they can be retired early
+   return score + 2.0f / std::sqrt(float(liveTriangles));
+}
+
+void optimizeVertexCache(std::vector<GLuint> &indices, size_t vertexCount) {
+   const size_t triangleCount = indices.size() / 3;
+   if (triangleCount == 0)
+      return;
+
+   // Triangles adjacent to each vertex, live ones first in every range
+   std::vector<uint32_t> live(vertexCount, 0);
+   for (GLuint index : indices)
+      live[index]++;
+
+   std::vector<uint32_t> offsets(vertexCount + 1, 0);
+   for (size_t v = 0; v < vertexCount; v++)
+      offsets[v + 1] = offsets[v] + live[v];
+
+   std::vector<uint32_t> adjacency(indices.size());
+   std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+   for (size_t i = 0; i < indices.size(); i++)
+      adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+   // Scores
+   std::vector<int> cachePosition(vertexCount, -1);
+   std::vector<float> scores(vertexCount);
+   for (size_t v = 0; v < vertexCount; v++)
+      scores[v] = vertexScore(-1, live[v]);
+
+   std::vector<float> triangleScores(triangleCount);
+   std::vector<bool> emitted(triangleCount, false);
+   for (size_t t = 0; t < triangleCount; t++) {
+      triangleScores[t] = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] +
+                          scores[indices[t * 3 + 2]];
+   }
+
+   std::vector<GLuint> result;
+   result.reserve(indices.size());
+
+   std::vector<GLuint> cache, nextCache;
+   cache.reserve(forsythCacheSize + 3);
+   nextCache.reserve(forsythCacheSize + 3);
+
+   size_t best = std::max_element(triangleScores.begin(),
+                                  triangleScores.end()) -
+                 triangleScores.begin();
+   size_t cursor = 0;
+
+   while (true) {
+      // Emit the best triangle and retire it from its vertices
+      emitted[best] = true;
+      for (size_t k = 0; k < 3; k++) {
+         GLuint v = indices[best * 3 + k];
+         result.push_back(v);
+
+         uint32_t *begin = &adjacency[offsets[v]];
+         uint32_t *end = begin + live[v];
+         std::iter_swap(std::find(begin, end, uint32_t(best)), end - 1);
+         live[v]--;
+      }
+
+      if (result.size() == indices.size())
+         break;
+
+      // Move the triangle's vertices to the front of the LRU cache
+      nextCache.assign(indices.begin() + best * 3,
+                       indices.begin() + best * 3 + 3);
+      for (GLuint v : cache) {
+         if (v != nextCache[0] && v != nextCache[1] && v != nextCache[2])
+            nextCache.push_back(v);
+      }
+
+      for (size_t i = 0; i < nextCache.size(); i++) {
+         GLuint v = nextCache[i];
+         cachePosition[v] = i < forsythCacheSize ? int(i) : -1;
+         scores[v] = vertexScore(cachePosition[v], live[v]);
+      }
+
+      // Only triangles around cached or evicted vertices change score
+      float bestScore = -1.0f;
+      for (GLuint v : nextCache) {
+         for (uint32_t j = 0; j < live[v]; j++) {
+            uint32_t t = adjacency[offsets[v] + j];
+            float score = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] +
+                          scores[indices[t * 3 + 2]];
+            triangleScores[t] = score;
+            if (score > bestScore) {
+               bestScore = score;
+               best = t;
+            }
+         }
+      }
+
+      if (nextCache.size() > forsythCacheSize)
+         nextCache.resize(forsythCacheSize);
+      std::swap(cache, nextCache);
+
+      // Dead end, restart from the next triangle that was not emitted
+      if (bestScore < 0.0f) {
+         while (emitted[cursor])
+            cursor++;
+         best = cursor;
+      }
+   }
+
+   indices.swap(result);
+}
+
+/// --- Overdraw ---
+void optimizeOverdraw(std::vector<GLuint> &indices,
+                      const std::vector<Vertex> &vertices, float threshold) {
+   const size_t triangleCount = indices.size() / 3;
+   if (triangleCount < 2)
+      return;
+
+   const size_t cacheSize = 16;
+   const size_t minClusterSize = 32;
+   const float targetACMR =
+       analyzeVertexCache(indices, vertices.size(), cacheSize).acmr *
+       threshold;
+
+   // Soft boundaries once a cluster is about as cheap as the whole mesh,
+   // hard ones where the cache would miss all three vertices anyway. Every
+   // cluster may end up anywhere, so it is simulated from a cold cache.
+   std::vector<size_t> clusters(1, 0);
+   std::vector<size_t> stamps(vertices.size(), 0);
+   size_t timestamp = cacheSize + 1;
+   size_t clusterMisses = 0;
+
+   for (size_t t = 0; t < triangleCount; t++) {
+      const size_t clusterSize = t - clusters.back();
+      if (clusterSize >= minClusterSize &&
+          float(clusterMisses) / float(clusterSize) <= targetACMR) {
+         clusters.push_back(t);
+         clusterMisses = 0;
+         timestamp += cacheSize + 1;
+      }
+
+      size_t misses = 0;
+      for (size_t k = 0; k < 3; k++) {
+         GLuint v = indices[t * 3 + k];
+         if (timestamp - stamps[v] > cacheSize) {
+            stamps[v] = timestamp++;
+            misses++;
+         }
+      }
+
+      if (misses == 3 && t > clusters.back()) {
+         clusters.push_back(t);
+         clusterMisses = 0;
+      }
+      clusterMisses += misses;
+   }
+   clusters.push_back(triangleCount);
+
+   // Sort key: how much the cluster faces away from the mesh center
+   glm::vec3 meshCenter(0.0f);
+   for (const Vertex &vertex : vertices)
+      meshCenter += vertex.Position;
+   meshCenter /= float(std::max<size_t>(vertices.size(), 1));
+
+   const size_t clusterCount = clusters.size() - 1;
+   std::vector<float> keys(clusterCount);
+   for (size_t c = 0; c < clusterCount; c++) {
+      glm::vec3 center(0.0f);
+      glm::vec3 normal(0.0f);
+      float area = 0.0f;
+
+      for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+         const glm::vec3 &p0 = vertices[indices[t * 3]].Position;
+         const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].Position;
+         const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].Position;
+
+         // Area weighted, the cross product length is twice the area
+         glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+         float weight = glm::length(cross);
+         center += (p0 + p1 + p2) * (weight / 3.0f);
+         normal += cross;
+         area += weight;
+      }
+
+      if (area > 0.0f)
+         center /= area;
+      float length = glm::length(normal);
+      if (length > 0.0f)
+         normal /= length;
+
+      keys[c] = glm::dot(center - meshCenter, normal);
+   }
+
+   std::vector<size_t> order(clusterCount);
+   for (size_t c = 0; c < clusterCount; c++)
+      order[c] = c;
+   std::stable_sort(order.begin(), order.end(),
+                    [&keys](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+   std::vector<GLuint> result;
+   result.reserve(indices.size());
+   for (size_t c : order) {
+      result.insert(result.end(), indices.begin() + clusters[c] * 3,
+                    indices.begin() + clusters[c + 1] * 3);
+   }
+   indices.swap(result);
+}
+
+/// --- Vertex Fetch ---
+void optimizeVertexFetch(std::vector<Vertex> &vertices,
+                         std::vector<GLuint> &indices) {
+   const GLuint unused = ~GLuint(0);
+   std::vector<GLuint> remap(vertices.size(), unused);
+   std::vector<Vertex> result;
+   result.reserve(vertices.size());
+
+   for (GLuint &index : indices) {
+      if (remap[index] == unused) {
+         remap[index] = static_cast<GLuint>(result.size());
+         result.push_back(vertices[index]);
+      }
+      index = remap[index];
+   }
+
+   vertices.swap(result);
+}
+
+MeshOptimizationReport optimizeMesh(MeshData &data, bool overdraw) {
+   MeshOptimizationReport report;
+   report.before = analyzeVertexCache(data.indices, data.vertices.size());
+
+   optimizeVertexCache(data.indices, data.vertices.size());
+   if (overdraw)
+      optimizeOverdraw(data.indices, data.vertices);
+   optimizeVertexFetch(data.vertices, data.indices);
+
+   report.after = analyzeVertexCache(data.indices, data.vertices.size());
+   return report;
+}
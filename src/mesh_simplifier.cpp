@@ -0,0 +1,366 @@
+#include "mesh_simplifier.h"
+
+// C++ Libraries
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_set>
+
+// Project Libraries
+#include "mapped_file.h"
+#include "mesh_optimizer.h"
+
+/// --- Welding ---
+// Maps every vertex to the first one whose leading keySize bytes are equal
+static std::vector<GLuint> weldVertices(const std::vector<Vertex> &vertices,
+                                        size_t keySize) {
+   size_t tableSize = 1;
+   while (tableSize < vertices.size() * 2)
+      tableSize <<= 1;
+
+   const GLuint empty = ~0u;
+   std::vector<GLuint> table(tableSize, empty);
+   std::vector<GLuint> remap(vertices.size());
+
+   for (size_t i = 0; i < vertices.size(); i++) {
+      const uint8_t *key = reinterpret_cast<const uint8_t *>(&vertices[i]);
+      size_t slot = hashBytes(key, keySize) & (tableSize - 1);
+
+      // Linear probing, the table is never more than half full
+      while (table[slot] != empty &&
+             std::memcmp(&vertices[table[slot]], key, keySize) != 0)
+         slot = (slot + 1) & (tableSize - 1);
+
+      if (table[slot] == empty)
+         table[slot] = static_cast<GLuint>(i);
+      remap[i] = table[slot];
+   }
+
+   return remap;
+}
+
+/// --- Quadrics ---
+// Sum of weighted squared plane distances, evaluating it and dividing by the
+// weight gives the mean squared distance of a point to the planes
+struct Quadric {
+   double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+   double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+   double c = 0.0;
+   double weight = 0.0;
+};
+
+static void addPlane(Quadric &q, const glm::dvec3 &normal,
+                     const glm::dvec3 &point, double weight) {
+   const glm::dvec3 n = normal * weight;
+   const double d = -glm::dot(normal, point);
+
+   q.a00 += n.x * normal.x;
+   q.a01 += n.x * normal.y;
+   q.a02 += n.x * normal.z;
+   q.a11 += n.y * normal.y;
+   q.a12 += n.y * normal.z;
+   q.a22 += n.z * normal.z;
+   q.b0 += n.x * d;
+   q.b1 += n.y * d;
+   q.b2 += n.z * d;
+   q.c += weight * d * d;
+   q.weight += weight;
+}
+
+static void addQuadric(Quadric &q, const Quadric &other) {
+   q.a00 += other.a00;
+   q.a01 += other.a01;
+   q.a02 += other.a02;
+   q.a11 += other.a11;
+   q.a12 += other.a12;
+   q.a22 += other.a22;
+   q.b0 += other.b0;
+   q.b1 += other.b1;
+   q.b2 += other.b2;
+   q.c += other.c;
+   q.weight += other.weight;
+}
+
+static double evaluate(const Quadric &q, const glm::vec3 &point) {
+   const double x = point.x, y = point.y, z = point.z;
+   const double result = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z +
+                         2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) +
+                         2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+   return std::max(result, 0.0);
+}
+
+// Open borders weigh more than faces so that silhouettes keep their shape
+static const double borderWeight = 10.0;
+
+static uint64_t edgeKey(GLuint from, GLuint to) {
+   return uint64_t(from) << 32 | to;
+}
+
+/// --- Simplification ---
+std::vector<GLuint> simplifyMesh(const std::vector<Vertex> &vertices,
+                                 const std::vector<GLuint> &indices,
+                                 size_t targetIndexCount, float &error) {
+   const size_t vertexCount = vertices.size();
+   error = 0.0f;
+
+   // Vertices with equal attributes are merged, vertices at the same position
+   // share topology and a quadric
+   const std::vector<GLuint> wedge =
+       weldVertices(vertices, offsetof(Vertex, Tangent));
+   const std::vector<GLuint> position =
+       weldVertices(vertices, sizeof(glm::vec3));
+
+   std::vector<GLuint> result(indices.size());
+   for (size_t i = 0; i < indices.size(); i++)
+      result[i] = wedge[indices[i]];
+
+   // A position referenced with several attribute sets lies on a seam
+   std::vector<GLuint> firstWedge(vertexCount, ~0u);
+   std::vector<uint8_t> seam(vertexCount, 0);
+   for (GLuint index : result) {
+      GLuint &first = firstWedge[position[index]];
+      if (first == ~0u)
+         first = index;
+      else if (first != index)
+         seam[position[index]] = 1;
+   }
+
+   // Directed edges in position space, an edge without its twin is open
+   std::unordered_set<uint64_t> edges;
+   std::vector<uint8_t> borderEdges(vertexCount);
+   auto findBorders = [&]() {
+      edges.clear();
+      edges.reserve(result.size());
+      for (size_t i = 0; i < result.size(); i += 3) {
+         for (size_t e = 0; e < 3; e++) {
+            edges.insert(edgeKey(position[result[i + e]],
+                                 position[result[i + (e + 1) % 3]]));
+         }
+      }
+
+      std::fill(borderEdges.begin(), borderEdges.end(), 0);
+      for (uint64_t key : edges) {
+         const GLuint from = GLuint(key >> 32), to = GLuint(key);
+         if (edges.count(edgeKey(to, from)) == 0) {
+            borderEdges[from] = uint8_t(std::min(borderEdges[from] + 1, 255));
+            borderEdges[to] = uint8_t(std::min(borderEdges[to] + 1, 255));
+         }
+      }
+   };
+   findBorders();
+
+   // Initial quadrics of the face planes and the planes along open borders
+   std::vector<Quadric> quadrics(vertexCount);
+   for (size_t i = 0; i < result.size(); i += 3) {
+      const GLuint p[3] = {position[result[i]], position[result[i + 1]],
+                           position[result[i + 2]]};
+      const glm::dvec3 v[3] = {vertices[p[0]].Position,
+                               vertices[p[1]].Position,
+                               vertices[p[2]].Position};
+
+      glm::dvec3 normal = glm::cross(v[1] - v[0], v[2] - v[0]);
+      const double area = glm::length(normal);
+      if (area == 0.0)
+         continue;
+      normal /= area;
+
+      for (size_t e = 0; e < 3; e++)
+         addPlane(quadrics[p[e]], normal, v[0], area);
+
+      for (size_t e = 0; e < 3; e++) {
+         const size_t next = (e + 1) % 3;
+         if (edges.count(edgeKey(p[next], p[e])) != 0)
+            continue;
+
+         const glm::dvec3 edge = v[next] - v[e];
+         const double length = glm::length(edge);
+         if (length == 0.0)
+            continue;
+
+         const glm::dvec3 borderNormal =
+             glm::normalize(glm::cross(edge, normal));
+         const double weight = length * length * borderWeight;
+         addPlane(quadrics[p[e]], borderNormal, v[e], weight);
+         addPlane(quadrics[p[next]], borderNormal, v[e], weight);
+      }
+   }
+
+   struct Collapse {
+      GLuint from, to;
+      double cost;
+   };
+   std::vector<Collapse> collapses;
+   std::vector<GLuint> remap(vertexCount);
+   std::vector<uint8_t> locked(vertexCount);
+   std::vector<GLuint> adjacencyOffsets(vertexCount + 1);
+   std::vector<GLuint> adjacency;
+   double maxCost = 0.0;
+
+   while (result.size() > targetIndexCount) {
+      // Candidate collapses along every triangle edge in both directions
+      collapses.clear();
+      for (size_t i = 0; i < result.size(); i += 3) {
+         for (size_t e = 0; e < 6; e++) {
+            const GLuint from = result[i + e % 3];
+            const GLuint to = result[i + (e % 3 + (e < 3 ? 1 : 2)) % 3];
+            const GLuint pf = position[from], pt = position[to];
+            if (seam[pf])
+               continue;
+
+            // Border vertices only slide along their border
+            if (borderEdges[pf] != 0) {
+               const bool open = edges.count(edgeKey(pf, pt)) == 0 ||
+                                 edges.count(edgeKey(pt, pf)) == 0;
+               if (!open || borderEdges[pf] != 2)
+                  continue;
+            }
+
+            const Quadric &qf = quadrics[pf], &qt = quadrics[pt];
+            const double weight = qf.weight + qt.weight;
+            if (weight == 0.0)
+               continue;
+
+            const glm::vec3 &target = vertices[pt].Position;
+            const double cost =
+                (evaluate(qf, target) + evaluate(qt, target)) / weight;
+            collapses.push_back({from, to, cost});
+         }
+      }
+
+      std::sort(collapses.begin(), collapses.end(),
+                [](const Collapse &a, const Collapse &b) {
+                   return a.cost < b.cost;
+                });
+
+      // Triangles around every position
+      std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+      for (GLuint index : result)
+         adjacencyOffsets[position[index] + 1]++;
+      for (size_t i = 0; i < vertexCount; i++)
+         adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+      adjacency.resize(result.size());
+      std::vector<GLuint> fill(adjacencyOffsets.begin(),
+                               adjacencyOffsets.end() - 1);
+      for (size_t i = 0; i < result.size(); i++)
+         adjacency[fill[position[result[i]]]++] = GLuint(i / 3);
+
+      // Apply the cheapest collapses, a vertex and its neighbourhood change
+      // at most once per pass so that the flip test below stays valid
+      for (size_t i = 0; i < vertexCount; i++)
+         remap[i] = GLuint(i);
+      std::fill(locked.begin(), locked.end(), 0);
+
+      const size_t triangleGoal =
+          (result.size() - targetIndexCount + 2) / 3;
+      size_t removed = 0;
+      size_t applied = 0;
+      for (const Collapse &collapse : collapses) {
+         if (removed >= triangleGoal)
+            break;
+
+         const GLuint pf = position[collapse.from];
+         const GLuint pt = position[collapse.to];
+         if (locked[pf] || locked[pt])
+            continue;
+
+         // Reject collapses that fold a remaining triangle over
+         const glm::vec3 &target = vertices[pt].Position;
+         bool flips = false;
+         for (GLuint j = adjacencyOffsets[pf];
+              j < adjacencyOffsets[pf + 1] && !flips; j++) {
+            const GLuint *triangle = &result[adjacency[j] * 3];
+            glm::vec3 corners[3];
+            bool collapsing = false;
+            for (size_t k = 0; k < 3; k++) {
+               collapsing = collapsing || position[triangle[k]] == pt;
+               corners[k] = vertices[triangle[k]].Position;
+            }
+            if (collapsing)
+               continue;
+
+            const glm::vec3 before =
+                glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+            for (size_t k = 0; k < 3; k++) {
+               if (position[triangle[k]] == pf)
+                  corners[k] = target;
+            }
+            const glm::vec3 after =
+                glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+            flips = glm::dot(before, after) <=
+                    0.25f * glm::length(before) * glm::length(after);
+         }
+         if (flips)
+            continue;
+
+         for (GLuint j = adjacencyOffsets[pf]; j < adjacencyOffsets[pf + 1];
+              j++) {
+            const GLuint *triangle = &result[adjacency[j] * 3];
+            for (size_t k = 0; k < 3; k++)
+               locked[position[triangle[k]]] = 1;
+         }
+
+         remap[collapse.from] = collapse.to;
+         addQuadric(quadrics[pt], quadrics[pf]);
+         maxCost = std::max(maxCost, collapse.cost);
+         removed += borderEdges[pf] != 0 ? 1 : 2;
+         applied++;
+      }
+
+      if (applied == 0)
+         break;
+
+      // Drop the triangles that collapsed into lines
+      size_t write = 0;
+      for (size_t i = 0; i < result.size(); i += 3) {
+         const GLuint a = remap[result[i]];
+         const GLuint b = remap[result[i + 1]];
+         const GLuint c = remap[result[i + 2]];
+         if (position[a] == position[b] || position[b] == position[c] ||
+             position[c] == position[a])
+            continue;
+
+         result[write++] = a;
+         result[write++] = b;
+         result[write++] = c;
+      }
+      result.resize(write);
+
+      findBorders();
+   }
+
+   error = float(std::sqrt(maxCost));
+   return result;
+}
+
+/// --- Level Of Detail ---
+void generateLods(MeshData &data, size_t levelCount) {
+   data.lods.assign(1, {0, static_cast<uint32_t>(data.indices.size()), 0.0f});
+
+   std::vector<GLuint> level = data.indices;
+   float error = 0.0f;
+   for (size_t i = 1; i < levelCount; i++) {
+      const size_t target = level.size() / 6 * 3;
+      if (target < minLodTriangles * 3)
+         break;
+
+      float levelError;
+      std::vector<GLuint> next =
+          simplifyMesh(data.vertices, level, target, levelError);
+
+      // Stop once seams and borders keep the simplifier from making progress
+      if (next.size() > level.size() * 3 / 4)
+         break;
+
+      // Each level is measured against the previous one, so their errors add
+      // up to a bound on the deviation from the full resolution mesh
+      error += levelError;
+      optimizeVertexCache(next, data.vertices.size());
+
+      data.lods.push_back({static_cast<uint32_t>(data.indices.size()),
+                           static_cast<uint32_t>(next.size()), error});
+      data.indices.insert(data.indices.end(), next.begin(), next.end());
+      level.swap(next);
+   }
+}
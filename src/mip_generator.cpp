@@ -0,0 +1,357 @@
+#include "mip_generator.h"
+
+// C++ Libraries
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Project Libraries
+#include "thread_pool.h"
+
+/// --- Filter ---
+// Radius in texels of the smaller level and shape of the Kaiser window
+static constexpr double filterRadius = 3.0;
+static constexpr double kaiserAlpha = 4.0;
+
+// Output rows of a level per task
+static constexpr int bandRows = 32;
+
+/// Zeroth order modified Bessel function of the first kind, by its series
+static double besselI0(double x) {
+   const double quarter = x * x * 0.25;
+   double sum = 1.0, term = 1.0;
+   for (int k = 1; k < 64 && term > sum * 1e-12; k++) {
+      term *= quarter / (double(k) * k);
+      sum += term;
+   }
+   return sum;
+}
+
+static double kaiserSinc(double x) {
+   if (std::abs(x) >= filterRadius)
+      return 0.0;
+   const double t = x / filterRadius;
+   const double window =
+       besselI0(kaiserAlpha * std::sqrt(1.0 - t * t)) / besselI0(kaiserAlpha);
+   const double angle = 3.14159265358979323846 * x;
+   return x == 0.0 ? window : std::sin(angle) / angle * window;
+}
+
+/// Taps along one axis. Target texel i sums taps source texels from
+/// first[i] on, which may lie beyond the edges
+struct FilterAxis {
+   int taps = 1;
+   std::vector<int> first;
+   std::vector<float> weights;
+};
+
+static FilterAxis filterAxis(int source, int target) {
+   FilterAxis axis;
+   axis.first.resize(target);
+   if (source == target) {
+      for (int i = 0; i < target; i++)
+         axis.first[i] = i;
+      axis.weights.assign(target, 1.0f);
+      return axis;
+   }
+
+   // The kernel is scaled to the spacing of the target texels
+   const double scale = double(source) / target;
+   const double support = filterRadius * scale;
+   for (int i = 0; i < target; i++) {
+      const double center = (i + 0.5) * scale;
+      axis.first[i] = int(std::ceil(center - support - 0.5));
+      const int last = int(std::floor(center + support - 0.5));
+      axis.taps = std::max(axis.taps, last - axis.first[i] + 1);
+   }
+
+   axis.weights.assign(size_t(target) * axis.taps, 0.0f);
+   std::vector<double> weights(axis.taps);
+   for (int i = 0; i < target; i++) {
+      const double center = (i + 0.5) * scale;
+      double sum = 0.0;
+      for (int t = 0; t < axis.taps; t++) {
+         weights[t] = kaiserSinc((axis.first[i] + t + 0.5 - center) / scale);
+         sum += weights[t];
+      }
+      for (int t = 0; t < axis.taps; t++)
+         axis.weights[size_t(i) * axis.taps + t] = float(weights[t] / sum);
+   }
+   return axis;
+}
+
+static int wrap(int i, int size) {
+   i %= size;
+   return i < 0 ? i + size : i;
+}
+
+/// --- Conversions ---
+/// sRGB to linear for every byte, linear to sRGB for 14 bits of linear
+/// values, which keeps dark texels within a step of their exact encoding
+struct SrgbTables {
+   static constexpr int steps = 16383;
+   float toLinear[256];
+   uint8_t fromLinear[steps + 1];
+
+   SrgbTables() {
+      for (int i = 0; i < 256; i++) {
+         const double c = i / 255.0;
+         toLinear[i] = float(c <= 0.04045 ? c / 12.92
+                                          : std::pow((c + 0.055) / 1.055, 2.4));
+      }
+      for (int i = 0; i <= steps; i++) {
+         const double l = double(i) / steps;
+         const double c = l <= 0.0031308
+                              ? l * 12.92
+                              : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+         fromLinear[i] = uint8_t(std::lround(c * 255.0));
+      }
+   }
+};
+
+static const SrgbTables &srgbTables() {
+   static const SrgbTables tables;
+   return tables;
+}
+
+static void decodeRow(const uint8_t *bytes, int width, TextureKind kind,
+                      float *texels) {
+   const SrgbTables &tables = srgbTables();
+   for (int i = 0; i < width * 4; i++) {
+      const bool alpha = i % 4 == 3;
+      if (kind == TextureKind::Color && !alpha)
+         texels[i] = tables.toLinear[bytes[i]];
+      else if (kind == TextureKind::Normal && !alpha)
+         texels[i] = bytes[i] / 127.5f - 1.0f;
+      else
+         texels[i] = bytes[i] / 255.0f;
+   }
+}
+
+static uint8_t unorm(float value) {
+   return uint8_t(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+/// Clamps away the ringing of the kernel, or renormalizes normals, and
+/// encodes the row
+static void encodeRow(float *texels, int width, TextureKind kind,
+                      uint8_t *bytes) {
+   const SrgbTables &tables = srgbTables();
+   for (int x = 0; x < width; x++) {
+      float *texel = texels + x * 4;
+      uint8_t *out = bytes + x * 4;
+      texel[3] = std::clamp(texel[3], 0.0f, 1.0f);
+      out[3] = unorm(texel[3]);
+
+      if (kind == TextureKind::Normal) {
+         const float length = std::sqrt(texel[0] * texel[0] +
+                                         texel[1] * texel[1] +
+                                         texel[2] * texel[2]);
+         if (length > 1e-6f) {
+            for (int c = 0; c < 3; c++)
+               texel[c] /= length;
+         } else {
+            texel[0] = texel[1] = 0.0f;
+            texel[2] = 1.0f;
+         }
+         for (int c = 0; c < 3; c++)
+            out[c] = unorm(texel[c] * 0.5f + 0.5f);
+         continue;
+      }
+
+      for (int c = 0; c < 3; c++) {
+         texel[c] = std::clamp(texel[c], 0.0f, 1.0f);
+         out[c] = kind == TextureKind::Color
+                      ? tables.fromLinear[int(texel[c] * SrgbTables::steps +
+                                              0.5f)]
+                      : unorm(texel[c]);
+      }
+   }
+}
+
+/// --- Kernels ---
+/// out = sum of weights[t] * row[first + t], texels of four floats
+static void convolve(const float *row, int width, int first, int taps,
+                     const float *weights, float *out) {
+   const bool inside = first >= 0 && first + taps <= width;
+#if defined(__SSE2__)
+   __m128 sum = _mm_setzero_ps();
+   for (int t = 0; t < taps; t++) {
+      const int x = inside ? first + t : wrap(first + t, width);
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]),
+                                       _mm_loadu_ps(row + x * 4)));
+   }
+   _mm_storeu_ps(out, sum);
+#else
+   float sum[4] = {};
+   for (int t = 0; t < taps; t++) {
+      const int x = inside ? first + t : wrap(first + t, width);
+      for (int c = 0; c < 4; c++)
+         sum[c] += weights[t] * row[x * 4 + c];
+   }
+   std::memcpy(out, sum, sizeof(sum));
+#endif
+}
+
+/// out += weight * row, count texels of four floats
+static void accumulate(float *out, const float *row, float weight,
+                       int count) {
+#if defined(__SSE2__)
+   const __m128 scale = _mm_set1_ps(weight);
+   for (int i = 0; i < count * 4; i += 4) {
+      _mm_storeu_ps(out + i,
+                    _mm_add_ps(_mm_loadu_ps(out + i),
+                               _mm_mul_ps(scale, _mm_loadu_ps(row + i))));
+   }
+#else
+   for (int i = 0; i < count * 4; i++)
+      out[i] += weight * row[i];
+#endif
+}
+
+/// --- Levels ---
+/// Level in linear light, four floats per texel. The base level is only
+/// held in bytes and decoded row by row
+struct LinearLevel {
+   int width = 0, height = 0;
+   const uint8_t *bytes = nullptr;
+   std::vector<float> texels;
+};
+
+/// Filters target rows [begin, end) from source: horizontally into the
+/// source rows the band needs, then vertically
+static void filterBand(const LinearLevel &source, LinearLevel &target,
+                       const FilterAxis &columns, const FilterAxis &rows,
+                       TextureKind kind, int begin, int end, uint8_t *bytes) {
+   const int firstRow = rows.first[begin];
+   const int rowCount = rows.first[end - 1] + rows.taps - firstRow;
+   const size_t rowSize = size_t(target.width) * 4;
+
+   std::vector<float> filtered(rowSize * rowCount);
+   std::vector<float> decoded(source.bytes ? size_t(source.width) * 4 : 0);
+   for (int r = 0; r < rowCount; r++) {
+      const int y = wrap(firstRow + r, source.height);
+      const float *row;
+      if (source.bytes) {
+         decodeRow(source.bytes + size_t(y) * source.width * 4, source.width,
+                   kind, decoded.data());
+         row = decoded.data();
+      } else {
+         row = source.texels.data() + size_t(y) * source.width * 4;
+      }
+
+      for (int x = 0; x < target.width; x++) {
+         convolve(row, source.width, columns.first[x], columns.taps,
+                  &columns.weights[size_t(x) * columns.taps],
+                  &filtered[rowSize * r + size_t(x) * 4]);
+      }
+   }
+
+   for (int y = begin; y < end; y++) {
+      float *out = &target.texels[rowSize * y];
+      std::fill(out, out + rowSize, 0.0f);
+      const float *weights = &rows.weights[size_t(y) * rows.taps];
+      for (int t = 0; t < rows.taps; t++) {
+         const int r = rows.first[y] + t - firstRow;
+         accumulate(out, &filtered[rowSize * r], weights[t], target.width);
+      }
+      encodeRow(out, target.width, kind, bytes + rowSize * y);
+   }
+}
+
+/// Runs body on bands of rows, on the workers of the pool and the calling
+/// thread. The caller may be a worker itself, waiting on the futures could
+/// then deadlock, so it only waits for bands that were already taken
+static void parallelBands(ThreadPool *pool, int rowCount,
+                          const std::function<void(int, int)> &body) {
+   struct Job {
+      std::atomic<int> next{0};
+      std::atomic<int> done{0};
+      int bands;
+      int rowCount;
+      const std::function<void(int, int)> *body;
+   };
+   auto job = std::make_shared<Job>();
+   (*job).bands = (rowCount + bandRows - 1) / bandRows;
+   (*job).rowCount = rowCount;
+   (*job).body = &body;
+
+   // Helpers that start late find no band left and never touch body
+   const auto work = [job]() {
+      int band;
+      while ((band = (*job).next++) < (*job).bands) {
+         const int begin = band * bandRows;
+         (*(*job).body)(begin, std::min(begin + bandRows, (*job).rowCount));
+         (*job).done++;
+      }
+   };
+
+   const int helpers =
+       pool ? std::min(int((*pool).size()), (*job).bands - 1) : 0;
+   for (int i = 0; i < helpers; i++)
+      (*pool).submit(work);
+
+   work();
+   while ((*job).done.load() < (*job).bands)
+      std::this_thread::yield();
+}
+
+std::vector<ImageLevel> mipChainLevels(int width, int height) {
+   std::vector<ImageLevel> levels;
+   size_t offset = 0;
+   for (int w = width, h = height;; w = std::max(w / 2, 1),
+            h = std::max(h / 2, 1)) {
+      const size_t size = size_t(w) * h * 4;
+      levels.push_back({w, h, offset, size});
+      offset += size;
+      if (w == 1 && h == 1)
+         break;
+   }
+   return levels;
+}
+
+MipChain generateMipChain(const uint8_t *rgba, int width, int height,
+                          TextureKind kind, ThreadPool *pool) {
+   MipChain chain;
+   chain.levels = mipChainLevels(width, height);
+   chain.data.resize(chain.levels.back().offset + chain.levels.back().size);
+   generateMipChainInto(rgba, width, height, kind, chain.data.data(), pool);
+   return chain;
+}
+
+void generateMipChainInto(const uint8_t *rgba, int width, int height,
+                          TextureKind kind, uint8_t *levels,
+                          ThreadPool *pool) {
+   const std::vector<ImageLevel> chain = mipChainLevels(width, height);
+   std::memcpy(levels, rgba, chain[0].size);
+
+   LinearLevel source, target;
+   source.width = width;
+   source.height = height;
+   source.bytes = rgba;
+   for (size_t i = 1; i < chain.size(); i++) {
+      const ImageLevel &level = chain[i];
+      target.width = level.width;
+      target.height = level.height;
+      target.bytes = nullptr;
+      target.texels.resize(size_t(level.width) * level.height * 4);
+
+      const FilterAxis columns = filterAxis(source.width, level.width);
+      const FilterAxis rows = filterAxis(source.height, level.height);
+      uint8_t *bytes = levels + level.offset;
+      parallelBands(pool, level.height, [&](int begin, int end) {
+         filterBand(source, target, columns, rows, kind, begin, end, bytes);
+      });
+
+      // Each level is filtered from the unquantized one above
+      std::swap(source, target);
+   }
+}
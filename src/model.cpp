@@ -1,48 +1,269 @@
 #include "model.h"
 #include "debug.h"
 
-Model::Model(std::string path, bool gamma) : gammaCorrection(gamma) {
-   loadModel(path);
+// C++ Libraries
+#include <algorithm>
+
+// Interval at which a waiting loader reports progress
+static const std::chrono::milliseconds progressInterval(16);
+
+template <typename T>
+static T waitFor(std::future<T> &future, LoadProgress &progress,
+                 size_t uploaded, size_t total) {
+   if (progress) {
+      while (future.wait_for(progressInterval) != std::future_status::ready)
+         progress(uploaded, total);
+   }
+   return future.get();
 }
 
-void Model::Draw(ShaderPipeline &shaderPipeline) {
+Model::Model(std::string path, ThreadPool &pool, TextureCache &textureCache,
+             GlState &glState, bool gamma, VertexFormat format,
+             LoadProgress progress)
+    : vertexFormat(format), materials(textureCache, glState, gamma) {
+   ProfileScope scope("Import");
+   loadModel(path, pool, progress);
+
+   // Spatial structures over the object space mesh bounds
+   ProfileScope bvhScope("BVH build");
+   std::vector<Aabb> boxes(meshes.size());
    for (size_t i = 0; i < meshes.size(); i++)
-      meshes[i].Draw(shaderPipeline);
+      boxes[i] = {meshes[i].bounds.min, meshes[i].bounds.max};
+   bvh.build(boxes, &pool);
+   cullingBounds.assign(meshes, bvh.order());
+}
+
+void Model::enqueue(RenderQueue &queue, ShaderPipeline &shaderPipeline,
+                    const glm::mat4 &model, const glm::vec3 &viewPos) const {
+   for (const Mesh &mesh : meshes) {
+      if (!mesh.visible)
+         continue;
+
+      DrawPacket packet;
+      packet.pipeline = &shaderPipeline;
+      packet.materials = &materials;
+      packet.material = mesh.material;
+      packet.mesh = &mesh;
+      packet.lod = mesh.lod;
+      packet.depth = glm::length(
+          glm::vec3(model * glm::vec4(mesh.bounds.center, 1.0f)) - viewPos);
+      queue.push(packet);
+   }
+}
+
+void Model::enqueueInstances(RenderQueue &queue,
+                             ShaderPipeline &shaderPipeline,
+                             const LodSelector &selector,
+                             const std::vector<glm::mat4> &instances,
+                             const glm::mat4 &viewProjection,
+                             const glm::vec3 &viewPos) const {
+   // Planes in the object space of every copy
+   std::vector<Frustum> frustums;
+   frustums.reserve(instances.size());
+   for (const glm::mat4 &instance : instances)
+      frustums.emplace_back(viewProjection * instance);
+
+   for (const Mesh &mesh : meshes) {
+      DrawPacket packet;
+      packet.pipeline = &shaderPipeline;
+      packet.materials = &materials;
+      packet.material = mesh.material;
+      packet.mesh = &mesh;
+      packet.instanceCount = 0;
+
+      // Copies nearer than others mostly need finer levels, so the runs end
+      // where the level changes and at copies the mesh is culled in
+      for (size_t i = 0; i <= instances.size(); i++) {
+         bool visible = false;
+         size_t lod = 0;
+         if (i < instances.size() &&
+             frustums[i].intersects(mesh.bounds.min, mesh.bounds.max)) {
+            visible = true;
+            lod = selector.select(mesh, instances[i], viewPos);
+         }
+
+         if (packet.instanceCount > 0 && (!visible || lod != packet.lod)) {
+            queue.push(packet);
+            packet.instanceCount = 0;
+         }
+         if (!visible)
+            continue;
+
+         if (packet.instanceCount == 0) {
+            packet.lod = lod;
+            packet.firstInstance = GLint(i);
+            packet.depth = glm::length(
+                glm::vec3(instances[i] * glm::vec4(mesh.bounds.center, 1.0f)) -
+                viewPos);
+         }
+         packet.instanceCount++;
+      }
+   }
+}
+
+Aabb Model::getBounds() const {
+   // The root of the hierarchy encloses every mesh
+   const std::vector<BvhNode> &nodes = bvh.getNodes();
+   if (nodes.empty())
+      return {glm::vec3(0.0f), glm::vec3(0.0f)};
+   return {nodes[0].boundsMin, nodes[0].boundsMax};
+}
+
+size_t Model::cull(const glm::mat4 &viewProjection, const glm::mat4 &model) {
+   ProfileScope scope("Culling");
+
+   // Planes in object space, the bounds never need to be transformed
+   const Frustum frustum(viewProjection * model);
+
+   // Leaves crossing a plane test their meshes, both are in leaf order
+   visibility.assign(meshes.size(), 0);
+   bvh.cull(frustum, [this, &frustum](uint32_t first, uint32_t count,
+                                      bool inside) {
+      if (inside)
+         std::fill_n(&visibility[first], count, 1);
+      else
+         cullingBounds.cull(frustum, first, count, &visibility[first]);
+   });
+
+   const std::vector<uint32_t> &order = bvh.order();
+   size_t visibleCount = 0;
+   for (size_t i = 0; i < order.size(); i++) {
+      meshes[order[i]].visible = visibility[i] != 0;
+      visibleCount += visibility[i];
+   }
+   return visibleCount;
+}
+
+bool Model::pick(const glm::vec3 &origin, const glm::vec3 &direction,
+                 const glm::mat4 &model, size_t &mesh, float &distance) const {
+   // Into object space, distances stay in units of the world space direction
+   const glm::mat4 inverse = glm::inverse(model);
+   BvhHit hit;
+   if (!bvh.raycast(glm::vec3(inverse * glm::vec4(origin, 1.0f)),
+                    glm::vec3(inverse * glm::vec4(direction, 0.0f)), hit))
+      return false;
+
+   mesh = hit.primitive;
+   distance = hit.distance;
+   return true;
+}
+
+void Model::selectLods(const LodSelector &selector, const glm::mat4 &model,
+                       const glm::vec3 &viewPos) {
+   for (Mesh &mesh : meshes)
+      mesh.lod = selector.select(mesh, model, viewPos);
+}
+
+void Model::requestTextures(const LodSelector &selector,
+                            const glm::mat4 &model,
+                            const glm::vec3 &viewPos) const {
+   for (const Mesh &mesh : meshes) {
+      if (mesh.visible)
+         materials.request(mesh.material,
+                           selector.projectedSize(mesh, model, viewPos));
+   }
 }
 
 /// --- Model Processing ---
-void Model::loadModel(std::string path) {
+void Model::loadModel(std::string path, ThreadPool &pool,
+                      LoadProgress &progress) {
+   const uint32_t importFlags = modelImportFlags;
+   directory = path.substr(0, path.find_last_of('/'));
+
+   // Repeat loads upload straight out of the mapped cache
+   MeshCache cache;
+   if (cache.open(path, importFlags)) {
+      meshes.reserve(cache.order().size());
+      for (uint32_t index : cache.order()) {
+         const MeshView &view = cache.meshes()[index];
+         const GLuint material =
+             materials.addMaterial(view.textures, directory);
+         meshes.emplace_back(view, material, vertexFormat);
+      }
+      return;
+   }
+
    Assimp::Importer importer;
-   const aiScene *scene = importer.ReadFile(
-       path, aiProcess_Triangulate | aiProcess_GenSmoothNormals |
-                 aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+
+   // Assimp parses serially, run it on a worker to keep this thread free
+   std::future<const aiScene *> reading =
+       pool.submit([&importer, &path, importFlags]() {
+          return importer.ReadFile(path, importFlags);
+       });
+   const aiScene *scene = waitFor(reading, progress, 0, 0);
 
    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE ||
        !scene->mRootNode) {
       debugMsg("ASSIMP", importer.GetErrorString());
       return;
    }
-   directory = path.substr(0, path.find_last_of('/'));
 
-   processNode(scene->mRootNode, scene);
-}
+   // CPU stage: convert and optimize every aiMesh in parallel
+   std::vector<std::future<MeshData>> converted;
+   std::vector<MeshOptimizationReport> reports(scene->mNumMeshes);
+   converted.reserve(scene->mNumMeshes);
+   for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+      converted.push_back(pool.submit([scene, i, &reports]() {
+         ProfileScope scope("Process mesh");
+         MeshData data = processMesh(scene->mMeshes[i], scene);
+         reports[i] = optimizeMesh(data);
+         generateLods(data);
+         return data;
+      }));
+   }
 
-void Model::processNode(aiNode *node, const aiScene *scene) {
-   for (size_t i = 0; i < node->mNumMeshes; i++) {
-      aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-      meshes.push_back(processMesh(mesh, scene));
+   // Meshes are drawn in node order and may be referenced by several nodes
+   std::vector<uint32_t> order;
+   processNode(scene->mRootNode, order);
+
+   // GL stage: upload each mesh on this thread as soon as it is converted
+   std::vector<MeshData> data(scene->mNumMeshes);
+   meshes.reserve(order.size());
+   for (uint32_t index : order) {
+      if (converted[index].valid()) {
+         data[index] =
+             waitFor(converted[index], progress, meshes.size(), order.size());
+
+         const MeshOptimizationReport &report = reports[index];
+         char line[128];
+         std::snprintf(line, sizeof(line),
+                       "Mesh %u: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, "
+                       "%zu LODs",
+                       index, report.before.acmr, report.after.acmr,
+                       report.before.atvr, report.after.atvr,
+                       data[index].lods.size());
+         debugMsg("Optimizer", line);
+      }
+
+      const GLuint material =
+          materials.addMaterial(data[index].textures, directory);
+      meshes.emplace_back(data[index], material, vertexFormat);
+   }
+
+   // Unreferenced meshes still read from the scene owned by the importer
+   for (size_t i = 0; i < converted.size(); i++) {
+      if (converted[i].valid())
+         data[i] = converted[i].get();
    }
 
+   MeshCache::write(path, importFlags, data, order);
+}
+
+void Model::processNode(aiNode *node, std::vector<uint32_t> &order) {
+   for (size_t i = 0; i < node->mNumMeshes; i++)
+      order.push_back(node->mMeshes[i]);
+
    for (size_t i = 0; i < node->mNumChildren; i++) {
-      processNode(node->mChildren[i], scene);
+      processNode(node->mChildren[i], order);
    }
 }
 
-Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene) {
-   std::vector<Vertex> vertices;
-   std::vector<GLuint> indices;
-   std::vector<Texture> textures;
+MeshData Model::processMesh(const aiMesh *mesh, const aiScene *scene) {
+   MeshData data;
+   std::vector<Vertex> &vertices = data.vertices;
+   std::vector<GLuint> &indices = data.indices;
 
+   vertices.reserve(mesh->mNumVertices);
    for (size_t i = 0; i < mesh->mNumVertices; i++) {
       Vertex vertex;
       glm::vec3 vector;
@@ -86,106 +307,38 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene) {
    }
 
    // Faces & Indices
+   indices.reserve(mesh->mNumFaces * 3);
    for (size_t i = 0; i < mesh->mNumFaces; i++) {
-      aiFace face = mesh->mFaces[i];
+      const aiFace &face = mesh->mFaces[i];
 
       for (size_t j = 0; j < face.mNumIndices; j++)
          indices.push_back(face.mIndices[j]);
    }
 
-   // Materials
-   aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
-
-   // Diffuse Maps
-   std::vector<Texture> diffuseMaps =
-       loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-   textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-
-   // Specular Maps
-   std::vector<Texture> specularMaps = loadMaterialTextures(
-       material, aiTextureType_SPECULAR, "texture_specular");
-   textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-
-   // Normal Maps
-   std::vector<Texture> normalMaps =
-       loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-   textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+   // Bounds for culling, level of detail selection and vertex quantization
+   data.bounds = computeBounds(vertices.data(), vertices.size());
 
-   // Height Maps
-   std::vector<Texture> heightMaps =
-       loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-   textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-
-   return Mesh(vertices, indices, textures);
+   // Materials
+   const aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
+
+   processMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse",
+                           data.textures);
+   processMaterialTextures(material, aiTextureType_SPECULAR,
+                           "texture_specular", data.textures);
+   processMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal",
+                           data.textures);
+   processMaterialTextures(material, aiTextureType_AMBIENT, "texture_height",
+                           data.textures);
+
+   return data;
 }
 
-/// --- Texture Handling ---
-std::vector<Texture> Model::loadMaterialTextures(aiMaterial *mat,
-                                                 aiTextureType type,
-                                                 std::string typeName) {
-   std::vector<Texture> textures;
+void Model::processMaterialTextures(const aiMaterial *mat,
+                                    aiTextureType type, std::string typeName,
+                                    std::vector<TextureRef> &textures) {
    for (size_t i = 0; i < mat->GetTextureCount(type); i++) {
       aiString str;
       mat->GetTexture(type, i, &str);
-
-      bool skip = false;
-      for (size_t j = 0; j < textures_loaded.size(); j++) {
-         if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0) {
-            textures.push_back(textures_loaded[j]);
-            skip = true;
-            break;
-         }
-      }
-      if (!skip) {
-         Texture texture;
-         texture.id = TextureFromFile(str.C_Str(), this->directory);
-         texture.type = typeName;
-         texture.path = str.C_Str();
-         textures.push_back(texture);
-         textures_loaded.push_back(texture);
-      }
+      textures.push_back({typeName, str.C_Str()});
    }
-
-   return textures;
-};
-
-GLuint Model::TextureFromFile(const char *path, const std::string &directory,
-                              bool gamma) {
-   std::string filename = std::string(path);
-   filename = directory + '/' + filename;
-
-   GLuint textureID;
-   glGenTextures(1, &textureID);
-
-   int width, height, nrComponents;
-   debugMsg("file", filename);
-   unsigned char *data =
-       stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-   if (data) {
-      GLenum format;
-      if (nrComponents == 1)
-         format = GL_RED;
-      else if (nrComponents == 3)
-         format = GL_RGB;
-      else if (nrComponents == 4)
-         format = GL_RGBA;
-
-      glBindTexture(GL_TEXTURE_2D, textureID);
-      glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,
-                   GL_UNSIGNED_BYTE, data);
-      glGenerateMipmap(GL_TEXTURE_2D);
-
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                      GL_LINEAR_MIPMAP_LINEAR);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-      stbi_image_free(data);
-   } else {
-      debugMsg("Texture", "Failed to load image data");
-      stbi_image_free(data);
-   }
-
-   return textureID;
-}
\ No newline at end of file
+}
@@ -0,0 +1,213 @@
+#include "model_batch.h"
+
+// C++ Libraries
+#include <algorithm>
+
+ModelBatch::ModelBatch(const Model &model, GlState &glState)
+    : materials(model.getMaterials()),
+      materialGeneration(model.getMaterials().getGeneration()),
+      glState(glState) {
+   const std::vector<Mesh> &meshes = model.getMeshes();
+   format = model.getVertexFormat();
+   const GLsizeiptr stride = vertexStride(format);
+
+   // Meshes of the same material are placed next to each other
+   std::vector<size_t> order(meshes.size());
+   for (size_t i = 0; i < order.size(); i++)
+      order[i] = i;
+   std::stable_sort(order.begin(), order.end(), [&meshes](size_t a, size_t b) {
+      return meshes[a].material < meshes[b].material;
+   });
+
+   // Place every mesh in the shared buffers
+   std::vector<GLuint> drawMaterials;
+   std::vector<DrawBounds> bounds;
+   commands.reserve(meshes.size());
+   sources.reserve(meshes.size());
+   drawMaterials.reserve(meshes.size());
+   bounds.reserve(meshes.size());
+
+   GLsizeiptr vertexCount = 0;
+   GLsizeiptr indexCount = 0;
+   for (size_t i : order) {
+      const MeshLod &lod = meshes[i].lods[meshes[i].lod];
+      sources.push_back(
+          {i, static_cast<GLuint>(indexCount), meshes[i].material});
+
+      DrawElementsIndirectCommand command;
+      command.count = lod.indexCount;
+      command.instanceCount = 1;
+      command.firstIndex = static_cast<GLuint>(indexCount) + lod.indexOffset;
+      command.baseVertex = static_cast<GLint>(vertexCount);
+      command.baseInstance = static_cast<GLuint>(commands.size());
+      commands.push_back(command);
+
+      drawMaterials.push_back(meshes[i].material);
+
+      DrawBounds drawBounds;
+      const MeshBounds &meshBounds = meshes[i].bounds;
+      drawBounds.boundsMin = glm::vec4(meshBounds.min, 0.0f);
+      drawBounds.boundsExtent =
+          glm::vec4(meshBounds.max - meshBounds.min, 0.0f);
+      bounds.push_back(drawBounds);
+
+      vertexCount += meshes[i].vertexCount;
+      indexCount += meshes[i].indexCount;
+   }
+
+   // Copy the mesh buffers on the GPU, no CPU side data is needed
+   glCreateBuffers(1, &VBO);
+   glCreateBuffers(1, &EBO);
+   glNamedBufferStorage(VBO, std::max<GLsizeiptr>(vertexCount, 1) * stride,
+                        nullptr, 0);
+   glNamedBufferStorage(EBO,
+                        std::max<GLsizeiptr>(indexCount, 1) * sizeof(GLuint),
+                        nullptr, 0);
+
+   for (size_t i = 0; i < order.size(); i++) {
+      const Mesh &mesh = meshes[order[i]];
+      glCopyNamedBufferSubData(mesh.getVertexBuffer(), VBO, 0,
+                               commands[i].baseVertex * stride,
+                               mesh.vertexCount * stride);
+      glCopyNamedBufferSubData(mesh.getIndexBuffer(), EBO, 0,
+                               sources[i].firstIndex * sizeof(GLuint),
+                               mesh.indexCount * sizeof(GLuint));
+   }
+
+   // Commands leave the order of the buffers from here on
+   groupDraws();
+
+   // Draw parameters
+   std::vector<GLuint> drawIDs(commands.size());
+   for (size_t i = 0; i < drawIDs.size(); i++)
+      drawIDs[i] = static_cast<GLuint>(i);
+
+   glCreateBuffers(1, &drawIDBuffer);
+   glCreateBuffers(1, &indirectBuffer);
+   glCreateBuffers(1, &materialBuffer);
+   glCreateBuffers(1, &boundsBuffer);
+   glNamedBufferStorage(drawIDBuffer,
+                        std::max<size_t>(drawIDs.size(), 1) * sizeof(GLuint),
+                        drawIDs.data(), 0);
+   glNamedBufferStorage(indirectBuffer,
+                        std::max<size_t>(commands.size(), 1) *
+                            sizeof(DrawElementsIndirectCommand),
+                        commands.data(), GL_DYNAMIC_STORAGE_BIT);
+   glNamedBufferStorage(materialBuffer,
+                        std::max<size_t>(drawMaterials.size(), 1) *
+                            sizeof(GLuint),
+                        drawMaterials.data(), 0);
+   glNamedBufferStorage(boundsBuffer,
+                        std::max<size_t>(bounds.size(), 1) * sizeof(DrawBounds),
+                        bounds.data(), 0);
+
+   setup();
+}
+
+ModelBatch::~ModelBatch() {
+   glState.deleteVertexArray(VAO);
+
+   GLuint buffers[] = {VBO, EBO, drawIDBuffer, indirectBuffer, materialBuffer,
+                       boundsBuffer};
+   glState.deleteBuffers(6, buffers);
+}
+
+void ModelBatch::setup() {
+   glCreateVertexArrays(1, &VAO);
+   glVertexArrayVertexBuffer(VAO, 0, VBO, 0, vertexStride(format));
+   glVertexArrayVertexBuffer(VAO, 1, drawIDBuffer, 0, sizeof(GLuint));
+   glVertexArrayBindingDivisor(VAO, 1, 1);
+   glVertexArrayElementBuffer(VAO, EBO);
+
+   // Vertex structure, see vertex_format.h, plus the draw ID at location 5
+   vertexAttributes(VAO, 0, format);
+
+   glEnableVertexArrayAttrib(VAO, 5);
+   glVertexArrayAttribIFormat(VAO, 5, 1, GL_UNSIGNED_INT, 0);
+   glVertexArrayAttribBinding(VAO, 5, 1);
+}
+
+void ModelBatch::groupDraws() {
+   // Commands sampling the same arrays become adjacent, then by material
+   std::vector<MaterialArrays> arrays(sources.size());
+   for (size_t i = 0; i < sources.size(); i++)
+      arrays[i] = materials.getArrays(sources[i].material);
+
+   std::stable_sort(commands.begin(), commands.end(),
+                    [this, &arrays](const DrawElementsIndirectCommand &a,
+                                    const DrawElementsIndirectCommand &b) {
+                       const GLuint drawA = a.baseInstance;
+                       const GLuint drawB = b.baseInstance;
+                       if (arrays[drawA] != arrays[drawB])
+                          return arrays[drawA] < arrays[drawB];
+                       return sources[drawA].material <
+                              sources[drawB].material;
+                    });
+
+   groups.clear();
+   for (size_t i = 0; i < commands.size(); i++) {
+      const MaterialArrays &drawArrays = arrays[commands[i].baseInstance];
+      if (groups.empty() || groups.back().arrays != drawArrays) {
+         DrawGroup group;
+         group.firstCommand = i;
+         group.arrays = drawArrays;
+         groups.push_back(group);
+      }
+      groups.back().commandCount++;
+   }
+}
+
+void ModelBatch::updateDraws(const Model &model) {
+   ProfileScope scope("Update draws");
+
+   const std::vector<Mesh> &meshes = model.getMeshes();
+
+   // Maps arrived or arrays moved, the commands are uploaded anyway
+   bool changed = false;
+   if (materials.getGeneration() != materialGeneration) {
+      materialGeneration = materials.getGeneration();
+      groupDraws();
+      changed = true;
+   }
+
+   for (size_t i = 0; i < commands.size(); i++) {
+      const DrawSource &source = sources[commands[i].baseInstance];
+      const Mesh &mesh = meshes[source.mesh];
+      const MeshLod &lod = mesh.lods[mesh.lod];
+      const GLuint firstIndex = source.firstIndex + lod.indexOffset;
+      const GLuint instanceCount = mesh.visible ? 1 : 0;
+
+      changed = changed || commands[i].firstIndex != firstIndex ||
+                commands[i].instanceCount != instanceCount;
+      commands[i].count = lod.indexCount;
+      commands[i].firstIndex = firstIndex;
+      commands[i].instanceCount = instanceCount;
+   }
+
+   // Draws rarely change between frames, skip the upload if none did
+   if (changed) {
+      const size_t size = commands.size() * sizeof(DrawElementsIndirectCommand);
+      glNamedBufferSubData(indirectBuffer, 0, size, commands.data());
+   }
+}
+
+void ModelBatch::Draw() {
+   ProfileScope scope("Draw submission");
+
+   glState.bindVertexArray(VAO);
+   glState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+   glState.bindBufferBase(GL_SHADER_STORAGE_BUFFER, drawMaterialBinding,
+                          materialBuffer);
+   glState.bindBufferBase(GL_SHADER_STORAGE_BUFFER, drawBoundsBinding,
+                          boundsBuffer);
+   materials.bind();
+
+   for (const DrawGroup &drawGroup : groups) {
+      drawGroup.arrays.bind(glState);
+
+      const size_t offset =
+          drawGroup.firstCommand * sizeof(DrawElementsIndirectCommand);
+      glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                  (void *)offset, drawGroup.commandCount, 0);
+   }
+}
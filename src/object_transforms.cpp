@@ -0,0 +1,89 @@
+#include "object_transforms.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+ObjectTransforms computeObjectTransforms(const glm::mat4 &model,
+                                         const glm::mat4 &viewProjection) {
+   // Inverse transpose of the upper 3x3, columns b x c, c x a and a x b over
+   // the determinant
+   const glm::vec3 a(model[0]), b(model[1]), c(model[2]);
+   const glm::vec3 bc = glm::cross(b, c);
+   const float determinant = glm::dot(a, bc);
+   const float scale = determinant != 0.0f ? 1.0f / determinant : 1.0f;
+
+   ObjectTransforms transforms;
+   transforms.model = model;
+   transforms.modelViewProjection = viewProjection * model;
+   transforms.normalMatrix[0] = glm::vec4(bc * scale, 0.0f);
+   transforms.normalMatrix[1] = glm::vec4(glm::cross(c, a) * scale, 0.0f);
+   transforms.normalMatrix[2] = glm::vec4(glm::cross(a, b) * scale, 0.0f);
+   return transforms;
+}
+
+#if defined(__SSE2__)
+/// (y, z, x, w) of u x v is u.yzx * v.zxy - u.zxy * v.yzx, w stays 0 for
+/// columns with w = 0
+static inline __m128 cross(__m128 u, __m128 v) {
+   const __m128 uYZX = _mm_shuffle_ps(u, u, _MM_SHUFFLE(3, 0, 2, 1));
+   const __m128 vYZX = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 2, 1));
+   const __m128 uZXY = _mm_shuffle_ps(u, u, _MM_SHUFFLE(3, 1, 0, 2));
+   const __m128 vZXY = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 1, 0, 2));
+   return _mm_sub_ps(_mm_mul_ps(uYZX, vZXY), _mm_mul_ps(uZXY, vYZX));
+}
+
+static inline float dot3(__m128 u, __m128 v) {
+   const __m128 product = _mm_mul_ps(u, v);
+   const __m128 y = _mm_shuffle_ps(product, product, _MM_SHUFFLE(1, 1, 1, 1));
+   const __m128 z = _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 2, 2, 2));
+   return _mm_cvtss_f32(_mm_add_ss(_mm_add_ss(product, y), z));
+}
+#endif
+
+void computeObjectTransforms(const glm::mat4 *models, size_t count,
+                             const glm::mat4 &viewProjection,
+                             ObjectTransforms *transforms) {
+#if defined(__SSE2__)
+   // The view projection columns stay in registers for the whole batch
+   const float *vp = &viewProjection[0][0];
+   const __m128 vp0 = _mm_loadu_ps(vp), vp1 = _mm_loadu_ps(vp + 4);
+   const __m128 vp2 = _mm_loadu_ps(vp + 8), vp3 = _mm_loadu_ps(vp + 12);
+   const __m128 clearW =
+       _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+
+   for (size_t i = 0; i < count; i++) {
+      const float *m = &models[i][0][0];
+      float *out = &transforms[i].model[0][0];
+      float *mvp = &transforms[i].modelViewProjection[0][0];
+      float *normal = &transforms[i].normalMatrix[0][0];
+
+      __m128 columns[4];
+      for (int j = 0; j < 4; j++) {
+         columns[j] = _mm_loadu_ps(m + 4 * j);
+         _mm_storeu_ps(out + 4 * j, columns[j]);
+
+         // Column j of viewProjection * model
+         __m128 r = _mm_mul_ps(vp0, _mm_set1_ps(m[4 * j]));
+         r = _mm_add_ps(r, _mm_mul_ps(vp1, _mm_set1_ps(m[4 * j + 1])));
+         r = _mm_add_ps(r, _mm_mul_ps(vp2, _mm_set1_ps(m[4 * j + 2])));
+         r = _mm_add_ps(r, _mm_mul_ps(vp3, _mm_set1_ps(m[4 * j + 3])));
+         _mm_storeu_ps(mvp + 4 * j, r);
+      }
+
+      const __m128 a = _mm_and_ps(columns[0], clearW);
+      const __m128 b = _mm_and_ps(columns[1], clearW);
+      const __m128 c = _mm_and_ps(columns[2], clearW);
+      const __m128 bc = cross(b, c);
+      const float determinant = dot3(a, bc);
+      const __m128 scale =
+          _mm_set1_ps(determinant != 0.0f ? 1.0f / determinant : 1.0f);
+      _mm_storeu_ps(normal, _mm_mul_ps(bc, scale));
+      _mm_storeu_ps(normal + 4, _mm_mul_ps(cross(c, a), scale));
+      _mm_storeu_ps(normal + 8, _mm_mul_ps(cross(a, b), scale));
+   }
+#else
+   for (size_t i = 0; i < count; i++)
+      transforms[i] = computeObjectTransforms(models[i], viewProjection);
+#endif
+}
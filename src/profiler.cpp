@@ -0,0 +1,169 @@
+#include "profiler.h"
+
+// C++ Libraries
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+// Project Libraries
+#include "debug.h"
+
+Profiler &getProfiler() {
+   static Profiler profiler;
+   return profiler;
+}
+
+double Profiler::now() const {
+   return std::chrono::duration<double, std::micro>(
+              std::chrono::steady_clock::now() - epoch)
+       .count();
+}
+
+void Profiler::addCpuEvent(const char *name, double start, double duration) {
+   std::lock_guard<std::mutex> lock(mutex);
+
+   // Small thread numbers read better in the trace than hashed ids
+   auto thread = threads.emplace(std::this_thread::get_id(),
+                                 int(threads.size()) + 1);
+   events.push_back({name, false, thread.first->second, start, duration});
+}
+
+/// --- GPU Scopes ---
+void Profiler::beginFrame() {
+   frame = (frame + 1) % profilerQueryFrames;
+   collect(pending[frame], false);
+}
+
+bool Profiler::beginGpuScope(const char *name) {
+   if (gpuScopeOpen) {
+      debugMsg("Profiler", std::string("Nested GPU scope ") + name);
+      return false;
+   }
+
+   GLuint query;
+   if (freeQueries.empty()) {
+      glGenQueries(1, &query);
+   } else {
+      query = freeQueries.back();
+      freeQueries.pop_back();
+   }
+
+   glBeginQuery(GL_TIME_ELAPSED, query);
+   pending[frame].push_back({name, query, now()});
+   gpuScopeOpen = true;
+   return true;
+}
+
+void Profiler::endGpuScope() {
+   glEndQuery(GL_TIME_ELAPSED);
+   gpuScopeOpen = false;
+}
+
+void Profiler::finish() {
+   for (std::vector<PendingQuery> &queries : pending)
+      collect(queries, true);
+
+   if (!freeQueries.empty())
+      glDeleteQueries(GLsizei(freeQueries.size()), freeQueries.data());
+   freeQueries.clear();
+}
+
+void Profiler::collect(std::vector<PendingQuery> &queries, bool wait) {
+   for (const PendingQuery &pendingQuery : queries) {
+      GLuint available = GL_TRUE;
+      if (!wait)
+         glGetQueryObjectuiv(pendingQuery.query, GL_QUERY_RESULT_AVAILABLE,
+                             &available);
+
+      // Still not done after a whole ring, drop it instead of stalling
+      if (available) {
+         GLuint64 elapsed = 0;
+         glGetQueryObjectui64v(pendingQuery.query, GL_QUERY_RESULT, &elapsed);
+
+         // There is no common clock, GPU events start with their CPU scope
+         std::lock_guard<std::mutex> lock(mutex);
+         events.push_back(
+             {pendingQuery.name, true, 0, pendingQuery.start, elapsed * 1e-3});
+      }
+      freeQueries.push_back(pendingQuery.query);
+   }
+   queries.clear();
+}
+
+/// --- Results ---
+ProfileStatistics Profiler::getStatistics(const std::string &name,
+                                          bool gpu) const {
+   std::vector<double> durations;
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (const ProfileEvent &event : events) {
+         if (event.gpu == gpu && name == event.name)
+            durations.push_back(event.duration * 1e-3);
+      }
+   }
+
+   ProfileStatistics statistics;
+   if (durations.empty())
+      return statistics;
+
+   std::sort(durations.begin(), durations.end());
+   statistics.count = durations.size();
+   statistics.min = durations.front();
+   for (double duration : durations)
+      statistics.avg += duration;
+   statistics.avg /= durations.size();
+   // Nearest rank
+   statistics.p99 = durations[(durations.size() * 99 + 99) / 100 - 1];
+   return statistics;
+}
+
+void Profiler::report() const {
+   // Every scope once, in order of first appearance
+   std::vector<std::pair<std::string, bool>> scopes;
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (const ProfileEvent &event : events) {
+         std::pair<std::string, bool> scope(event.name, event.gpu);
+         if (std::find(scopes.begin(), scopes.end(), scope) == scopes.end())
+            scopes.push_back(scope);
+      }
+   }
+
+   for (const auto &scope : scopes) {
+      const ProfileStatistics statistics =
+          getStatistics(scope.first, scope.second);
+
+      char line[256];
+      std::snprintf(line, sizeof(line),
+                    "%s %s: %zu calls, min %.3f ms, avg %.3f ms, p99 %.3f ms",
+                    scope.second ? "GPU" : "CPU", scope.first.c_str(),
+                    statistics.count, statistics.min, statistics.avg,
+                    statistics.p99);
+      debugMsg("Profiler", line);
+   }
+}
+
+bool Profiler::writeTrace(const std::string &path) const {
+   std::ofstream file(path);
+   if (!file.is_open()) {
+      debugMsg("Profiler", "Could not open " + path);
+      return false;
+   }
+
+   // Complete ("X") events, GPU scopes on a track of their own
+   std::lock_guard<std::mutex> lock(mutex);
+   file << "{\"traceEvents\":[\n";
+   file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,"
+           "\"args\":{\"name\":\"GPU\"}}";
+   char line[256];
+   for (const ProfileEvent &event : events) {
+      std::snprintf(line, sizeof(line),
+                    ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                    "\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%d}",
+                    event.name, event.gpu ? "gpu" : "cpu", event.start,
+                    event.duration, event.thread);
+      file << line;
+   }
+   file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+   return bool(file);
+}
@@ -0,0 +1,217 @@
+#include "render_queue.h"
+
+// C++ Libraries
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+// Project Libraries
+#include "debug.h"
+#include "gl_state.h"
+#include "profiler.h"
+
+/// Upper 20 bits of a non-negative float below the sign, which order like
+/// the value itself
+static uint64_t depthBits(float depth) {
+   depth = std::max(depth, 0.0f);
+   uint32_t bits;
+   std::memcpy(&bits, &depth, sizeof(bits));
+   return bits >> 11;
+}
+
+void RenderQueue::clear() {
+   packets.clear();
+   pipelines.clear();
+   arraySets.clear();
+   packetPipelines.clear();
+   packetArrays.clear();
+}
+
+void RenderQueue::push(const DrawPacket &packet) {
+   auto pipeline =
+       std::find(pipelines.begin(), pipelines.end(), packet.pipeline);
+   packetPipelines.push_back(
+       static_cast<uint32_t>(pipeline - pipelines.begin()));
+   if (pipeline == pipelines.end())
+      pipelines.push_back(packet.pipeline);
+
+   // Usually a handful of distinct sets, one per size of the maps
+   const MaterialArrays arrays =
+       (*packet.materials).getArrays(packet.material);
+   auto found = std::find(arraySets.begin(), arraySets.end(), arrays);
+   packetArrays.push_back(static_cast<uint32_t>(found - arraySets.begin()));
+   if (found == arraySets.end())
+      arraySets.push_back(arrays);
+
+   packets.push_back(packet);
+}
+
+/// --- Sorting ---
+uint64_t RenderQueue::sortKey(uint32_t index) const {
+   const DrawPacket &packet = packets[index];
+
+   // Fields beyond their width only sort less tightly, the submission
+   // still compares the actual state
+   const uint64_t pipeline = std::min<uint64_t>(packetPipelines[index], 0x7F);
+   const uint64_t arrays = std::min<uint64_t>(packetArrays[index], 0xFFF);
+   const uint64_t material = std::min<uint64_t>(packet.material, 0xFFF);
+   const uint64_t vertexArray = (*packet.mesh).getVertexArray() & 0xFFF;
+   const uint64_t depth = depthBits(packet.depth);
+
+   // Opaque: pipeline | arrays | material | depth | vertex array, nearest
+   // first for early depth rejection. Every mesh owns its vertex array, so
+   // it only breaks ties
+   if (!packet.transparent)
+      return pipeline << 56 | arrays << 44 | material << 32 | depth << 12 |
+             vertexArray;
+
+   // Transparent: 1 | farthest first | pipeline | arrays | material | vertex
+   // array, blending needs the order more than fewer state changes
+   return uint64_t(1) << 63 | (depth ^ 0xFFFFF) << 43 | pipeline << 36 |
+          arrays << 24 | material << 12 | vertexArray;
+}
+
+void RenderQueue::sort() {
+   const size_t count = packets.size();
+   keys.resize(count);
+   order.resize(count);
+   keyScratch.resize(count);
+   orderScratch.resize(count);
+   for (size_t i = 0; i < count; i++) {
+      keys[i] = sortKey(static_cast<uint32_t>(i));
+      order[i] = static_cast<uint32_t>(i);
+   }
+   if (count == 0)
+      return;
+
+   // LSD radix sort, a byte per pass. Bytes all keys share are skipped,
+   // e.g. the transparency bit and the unused pipeline ids
+   for (int shift = 0; shift < 64; shift += 8) {
+      size_t offsets[256] = {};
+      for (uint64_t key : keys)
+         offsets[(key >> shift) & 0xFF]++;
+      if (offsets[(keys[0] >> shift) & 0xFF] == count)
+         continue;
+
+      size_t sum = 0;
+      for (size_t &offset : offsets) {
+         const size_t bucket = offset;
+         offset = sum;
+         sum += bucket;
+      }
+
+      for (size_t i = 0; i < count; i++) {
+         const size_t slot = offsets[(keys[i] >> shift) & 0xFF]++;
+         keyScratch[slot] = keys[i];
+         orderScratch[slot] = order[i];
+      }
+      keys.swap(keyScratch);
+      order.swap(orderScratch);
+   }
+}
+
+/// --- Submission ---
+void RenderQueue::submit() {
+   ProfileScope scope("Draw submission");
+
+   sort();
+   stats.packets += packets.size();
+
+   static constexpr UniformID materialID = uniformID("materialIndex");
+   static constexpr UniformID firstInstanceID = uniformID("firstInstance");
+
+   const ShaderPipeline *pipeline = nullptr;
+   const MaterialSystem *materials = nullptr;
+   uint32_t arrays = UINT32_MAX;
+   GLint material = -1;
+   GLint firstInstance = -1;
+   GLuint vertexArray = 0;
+   bool blending = false;
+
+   for (uint32_t index : order) {
+      const DrawPacket &packet = packets[index];
+
+      // Transparent draws come last, they test but do not write depth
+      if (packet.transparent && !blending) {
+         glState.setEnabled(GL_BLEND, true);
+         glState.setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+         glState.setDepthMask(GL_FALSE);
+         blending = true;
+      }
+
+      if (packet.pipeline != pipeline) {
+         (*packet.pipeline).use();
+         pipeline = packet.pipeline;
+         material = -1;
+         firstInstance = -1;
+         stats.pipelines.changes++;
+      } else {
+         stats.pipelines.avoided++;
+      }
+
+      if (packet.materials != materials) {
+         (*packet.materials).bind();
+         materials = packet.materials;
+         arrays = UINT32_MAX;
+         material = -1;
+      }
+
+      if (packetArrays[index] != arrays) {
+         arraySets[packetArrays[index]].bind(glState);
+         arrays = packetArrays[index];
+         stats.textures.changes++;
+      } else {
+         stats.textures.avoided++;
+      }
+
+      if (GLint(packet.material) != material) {
+         (*pipeline).setInt((*pipeline).getUniform(materialID),
+                            packet.material);
+         material = packet.material;
+         stats.materials.changes++;
+      } else {
+         stats.materials.avoided++;
+      }
+
+      if ((*packet.mesh).getVertexArray() != vertexArray) {
+         vertexArray = (*packet.mesh).getVertexArray();
+         glState.bindVertexArray(vertexArray);
+         stats.vertexArrays.changes++;
+      } else {
+         stats.vertexArrays.avoided++;
+      }
+
+      // Pipelines without instances have no such uniform and ignore it
+      if (packet.firstInstance != firstInstance) {
+         (*pipeline).setInt((*pipeline).getUniform(firstInstanceID),
+                            packet.firstInstance);
+         firstInstance = packet.firstInstance;
+      }
+
+      (*packet.mesh).submit(*pipeline, packet.lod, packet.instanceCount);
+   }
+
+   if (blending) {
+      glState.setDepthMask(GL_TRUE);
+      glState.setEnabled(GL_BLEND, false);
+   }
+}
+
+void RenderQueue::report() const {
+   const std::pair<const char *, const StateCounter *> counters[] = {
+       {"pipelines", &stats.pipelines},
+       {"textures", &stats.textures},
+       {"materials", &stats.materials},
+       {"vertex arrays", &stats.vertexArrays}};
+
+   char line[128];
+   std::snprintf(line, sizeof(line), "%zu packets", stats.packets);
+   debugMsg("Render queue", line);
+   for (const auto &counter : counters) {
+      std::snprintf(line, sizeof(line), "%s: %zu changes, %zu avoided",
+                    counter.first, (*counter.second).changes,
+                    (*counter.second).avoided);
+      debugMsg("Render queue", line);
+   }
+}
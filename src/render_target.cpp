@@ -0,0 +1,53 @@
+#include "render_target.h"
+
+// C++ Libraries
+#include <cstring>
+
+RenderTarget::RenderTarget(GLsizei width, GLsizei height)
+    : width(width), height(height) {
+   glCreateRenderbuffers(1, &colorBuffer);
+   glNamedRenderbufferStorage(colorBuffer, GL_RGBA8, width, height);
+   glCreateRenderbuffers(1, &depthBuffer);
+   glNamedRenderbufferStorage(depthBuffer, GL_DEPTH24_STENCIL8, width, height);
+
+   glCreateFramebuffers(1, &FBO);
+   glNamedFramebufferRenderbuffer(FBO, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                                  colorBuffer);
+   glNamedFramebufferRenderbuffer(FBO, GL_DEPTH_STENCIL_ATTACHMENT,
+                                  GL_RENDERBUFFER, depthBuffer);
+}
+
+RenderTarget::~RenderTarget() {
+   glDeleteFramebuffers(1, &FBO);
+   glDeleteRenderbuffers(1, &colorBuffer);
+   glDeleteRenderbuffers(1, &depthBuffer);
+}
+
+bool RenderTarget::isComplete() const {
+   return glCheckNamedFramebufferStatus(FBO, GL_DRAW_FRAMEBUFFER) ==
+          GL_FRAMEBUFFER_COMPLETE;
+}
+
+void RenderTarget::bind() const {
+   glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+   glViewport(0, 0, width, height);
+}
+
+void RenderTarget::readPixels(std::vector<uint8_t> &pixels) const {
+   const size_t rowSize = size_t(width) * 3;
+   pixels.resize(rowSize * height);
+
+   glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+   glPixelStorei(GL_PACK_ALIGNMENT, 1);
+   glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+   // OpenGL returns the bottom row first
+   std::vector<uint8_t> row(rowSize);
+   for (GLsizei y = 0; y < height / 2; y++) {
+      uint8_t *top = pixels.data() + rowSize * y;
+      uint8_t *bottom = pixels.data() + rowSize * (height - 1 - y);
+      std::memcpy(row.data(), top, rowSize);
+      std::memcpy(top, bottom, rowSize);
+      std::memcpy(bottom, row.data(), rowSize);
+   }
+}
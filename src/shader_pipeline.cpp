@@ -1,14 +1,20 @@
 #include "shader_pipeline.h"
 
-ShaderPipeline::ShaderPipeline(ShaderPaths paths) {
-   vertexShader = genShader(GL_VERTEX_SHADER, paths.vertexPath);
-   fragmentShader = genShader(GL_FRAGMENT_SHADER, paths.fragmentPath);
+ShaderPipeline::ShaderPipeline(ShaderPaths paths, GlState &glState)
+    : glState(glState) {
+   vertexShader = genShader(GL_VERTEX_SHADER, paths.vertexPath, paths.defines);
+   fragmentShader =
+       genShader(GL_FRAGMENT_SHADER, paths.fragmentPath, paths.defines);
    shaderProgram = genProgram();
+   reflectUniforms();
 }
 
-ShaderPipeline::~ShaderPipeline() { glDeleteProgram(shaderProgram); }
+ShaderPipeline::~ShaderPipeline() {
+   glState.deleteProgram(shaderProgram);
+}
 
-GLuint ShaderPipeline::genShader(GLenum type, std::string file) {
+GLuint ShaderPipeline::genShader(GLenum type, std::string file,
+                                 const std::vector<std::string> &defines) {
    // Create shader object and obtain its ID
    GLuint shader = glCreateShader(type);
 
@@ -25,6 +31,19 @@ GLuint ShaderPipeline::genShader(GLenum type, std::string file) {
       debugMsg("Shader", "Failed to read file");
    }
 
+   // Defines have to follow the #version directive
+   if (!defines.empty()) {
+      std::string block;
+      for (const std::string &define : defines)
+         block += "#define " + define + "\n";
+
+      size_t version = shaderSource.find("#version");
+      size_t line = version == std::string::npos
+                        ? 0
+                        : shaderSource.find('\n', version) + 1;
+      shaderSource.insert(line, block);
+   }
+
    const char *shaderSourcePointer = shaderSource.c_str();
 
    // Compile shader
@@ -73,19 +92,69 @@ GLuint ShaderPipeline::genProgram() {
    return program;
 }
 
-void ShaderPipeline::setVec3(const std::string &name,
+void ShaderPipeline::reflectUniforms() {
+   GLint uniformCount, maxNameLength;
+   glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORMS, &uniformCount);
+   glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+   // Keep the load factor at or below one half
+   size_t capacity = 1;
+   while (capacity < static_cast<size_t>(uniformCount) * 2)
+      capacity <<= 1;
+   uniforms.assign(capacity, UniformInfo());
+
+   std::vector<GLchar> nameBuffer(maxNameLength > 0 ? maxNameLength : 1);
+   for (GLint i = 0; i < uniformCount; i++) {
+      UniformInfo info;
+      GLsizei nameLength;
+      glGetActiveUniform(shaderProgram, i, nameBuffer.size(), &nameLength,
+                         &info.size, &info.type, nameBuffer.data());
+
+      // Arrays are reported as "name[0]", register them by their base name
+      std::string name(nameBuffer.data(), nameLength);
+      if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+         name.resize(name.size() - 3);
+
+      // Uniforms inside of uniform blocks have no location
+      info.location = glGetUniformLocation(shaderProgram, name.c_str());
+      if (info.location < 0)
+         continue;
+      info.id = uniformID(name.c_str());
+
+      size_t slot = info.id & (capacity - 1);
+      while (uniforms[slot].location >= 0) {
+         if (uniforms[slot].id == info.id) {
+            debugMsg("Shader", "Uniform hash collision on " + name);
+            break;
+         }
+         slot = (slot + 1) & (capacity - 1);
+      }
+      uniforms[slot] = info;
+   }
+}
+
+UniformHandle ShaderPipeline::getUniform(const UniformID id) const {
+   const size_t mask = uniforms.size() - 1;
+   for (size_t slot = id & mask;; slot = (slot + 1) & mask) {
+      const UniformInfo &info = uniforms[slot];
+      if (info.location < 0)
+         return -1;
+      if (info.id == id)
+         return info.location;
+   }
+}
+
+void ShaderPipeline::setVec3(const UniformHandle handle,
                              const GLfloat *value) const {
-   uint16_t uniLoc = glGetUniformLocation(this->shaderProgram, name.c_str());
-   glUniform3fv(uniLoc, 1, value);
+   glUniform3fv(handle, 1, value);
 }
 
-void ShaderPipeline::setMat4(const std::string &name,
+void ShaderPipeline::setMat4(const UniformHandle handle,
                              const GLfloat *value) const {
-   uint16_t uniLoc = glGetUniformLocation(this->shaderProgram, name.c_str());
-   glUniformMatrix4fv(uniLoc, 1, GL_FALSE, value);
+   glUniformMatrix4fv(handle, 1, GL_FALSE, value);
 }
 
-void ShaderPipeline::setInt(const std::string &name, const GLint value) const {
-   uint16_t uniLoc = glGetUniformLocation(this->shaderProgram, name.c_str());
-   glUniform1i(uniLoc, value);
+void ShaderPipeline::setInt(const UniformHandle handle,
+                            const GLint value) const {
+   glUniform1i(handle, value);
 }
@@ -0,0 +1,83 @@
+#version 450 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+flat in uint DrawID;
+in TANGENT {
+    vec3 TangentLightPos;
+    vec3 TangentViewPos;
+    vec3 TangentFragPos;
+} tng;
+
+// Material records and the texture arrays of the draw, see material_system.h
+const uint MATERIAL_DIFFUSE  = 1u << 0;
+const uint MATERIAL_SPECULAR = 1u << 1;
+const uint MATERIAL_NORMAL   = 1u << 2;
+
+struct MaterialRecord {
+    uint flags;
+    uint layers[3];
+};
+
+layout (std430, binding = 3) readonly buffer Materials {
+    MaterialRecord materials[];
+};
+
+layout (binding = 0) uniform sampler2DArray diffuseMaps;
+layout (binding = 1) uniform sampler2DArray specularMaps;
+layout (binding = 2) uniform sampler2DArray normalMaps;
+
+// Material of each draw, see model_batch.h
+layout (std430, binding = 0) readonly buffer DrawMaterials {
+    uint drawMaterials[];
+};
+
+// See uniform_buffer.h
+layout (std140, binding = 1) uniform LightBlock {
+    vec3 position;
+    vec3 ambient;
+    vec3 specular;
+    vec3 color;
+} light;
+
+void main() {
+    MaterialRecord material = materials[drawMaterials[DrawID]];
+
+    // Maps missing from the material or not yet streamed in fall back to
+    // neutral values
+    vec3 albedo = (material.flags & MATERIAL_DIFFUSE) != 0u
+                      ? texture(diffuseMaps, vec3(TexCoord, material.layers[0])).rgb
+                      : vec3(1.0);
+    vec3 specularMap = (material.flags & MATERIAL_SPECULAR) != 0u
+                           ? texture(specularMaps, vec3(TexCoord, material.layers[1])).rgb
+                           : vec3(0.0);
+
+    // Ambient Light
+    vec3 ambientLight = light.ambient * albedo * light.color;
+
+    // Normal Map
+    vec3 norm = vec3(0.0, 0.0, 1.0);
+    if ((material.flags & MATERIAL_NORMAL) != 0u) {
+        // Two channels, BC5 stores no z
+        vec2 xy = texture(normalMaps, vec3(TexCoord, material.layers[2])).rg * 2.0 - 1.0;
+        norm = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+    }
+
+    // Diffuse Light
+    vec3 lightDir = normalize(tng.TangentLightPos - tng.TangentFragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuseLight = diff * albedo * light.color;
+
+    // Specular Light
+    vec3 viewDir = normalize(tng.TangentViewPos - tng.TangentFragPos);
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+    vec3 specular = light.specular * spec * specularMap * light.color;
+
+    FragColor = vec4((ambientLight + diffuseLight + specular), 1.0);
+
+#ifdef GAMMA_CORRECTION
+    // Lit in linear space, the framebuffer expects sRGB
+    FragColor.rgb = pow(FragColor.rgb, vec3(1.0 / 2.2));
+#endif
+}
@@ -8,39 +8,73 @@ in TANGENT {
     vec3 TangentFragPos;
 } tng;
 
-struct Material {
-    sampler2D texture_diffuse1;
-    sampler2D texture_normal1;
-    sampler2D texture_specular1;
+// Material records and the texture arrays of the draw, see material_system.h
+const uint MATERIAL_DIFFUSE  = 1u << 0;
+const uint MATERIAL_SPECULAR = 1u << 1;
+const uint MATERIAL_NORMAL   = 1u << 2;
+
+struct MaterialRecord {
+    uint flags;
+    uint layers[3];
+};
+
+layout (std430, binding = 3) readonly buffer Materials {
+    MaterialRecord materials[];
 };
 
-struct Light {
+layout (binding = 0) uniform sampler2DArray diffuseMaps;
+layout (binding = 1) uniform sampler2DArray specularMaps;
+layout (binding = 2) uniform sampler2DArray normalMaps;
+
+// Material of the mesh, see Mesh::Draw
+uniform int materialIndex;
+
+// See uniform_buffer.h
+layout (std140, binding = 1) uniform LightBlock {
+    vec3 position;
     vec3 ambient;
     vec3 specular;
     vec3 color;
-};
-
-uniform Material material;
-uniform Light light;
+} light;
 
 void main() {
+    MaterialRecord material = materials[materialIndex];
+
+    // Maps missing from the material or not yet streamed in fall back to
+    // neutral values
+    vec3 albedo = (material.flags & MATERIAL_DIFFUSE) != 0u
+                      ? texture(diffuseMaps, vec3(TexCoord, material.layers[0])).rgb
+                      : vec3(1.0);
+    vec3 specularMap = (material.flags & MATERIAL_SPECULAR) != 0u
+                           ? texture(specularMaps, vec3(TexCoord, material.layers[1])).rgb
+                           : vec3(0.0);
+
     // Ambient Light
-    vec3 ambientLight = light.ambient * texture(material.texture_diffuse1, TexCoord).rgb * light.color;
+    vec3 ambientLight = light.ambient * albedo * light.color;
 
     // Normal Map
-    vec3 norm = texture(material.texture_normal1, TexCoord).rgb;
-    norm = normalize(norm * 2.0 - 1.0);
+    vec3 norm = vec3(0.0, 0.0, 1.0);
+    if ((material.flags & MATERIAL_NORMAL) != 0u) {
+        // Two channels, BC5 stores no z
+        vec2 xy = texture(normalMaps, vec3(TexCoord, material.layers[2])).rg * 2.0 - 1.0;
+        norm = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+    }
 
     // Diffuse Light
     vec3 lightDir = normalize(tng.TangentLightPos - tng.TangentFragPos);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuseLight = diff * texture(material.texture_diffuse1, TexCoord).rgb * light.color;
+    vec3 diffuseLight = diff * albedo * light.color;
 
     // Specular Light
     vec3 viewDir = normalize(tng.TangentViewPos - tng.TangentFragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
-    vec3 specular = light.specular * spec * texture(material.texture_specular1, TexCoord).rgb * light.color;
+    vec3 specular = light.specular * spec * specularMap * light.color;
 
     FragColor = vec4((ambientLight + diffuseLight + specular), 1.0);
+
+#ifdef GAMMA_CORRECTION
+    // Lit in linear space, the framebuffer expects sRGB
+    FragColor.rgb = pow(FragColor.rgb, vec3(1.0 / 2.2));
+#endif
 }
@@ -1,9 +1,16 @@
 #version 450 core
+#ifdef PACKED_VERTICES
+// Quantized vertices, see vertex_format.h
+layout (location = 0) in vec4 aPos;
+layout (location = 1) in uint aFrame;
+layout (location = 2) in vec2 aTexCoord;
+#else
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
 layout (location = 3) in vec3 aTangent;
 layout (location = 4) in vec3 aBitangent;
+#endif
 
 out vec2 TexCoord;
 out TANGENT {
@@ -12,28 +19,97 @@ out TANGENT {
     vec3 TangentFragPos;
 } tng;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Per frame, per light and per object data, see uniform_buffer.h
+layout (std140, binding = 0) uniform FrameBlock {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+} frame;
+
+layout (std140, binding = 1) uniform LightBlock {
+    vec3 position;
+    vec3 ambient;
+    vec3 specular;
+    vec3 color;
+} light;
+
+// Precomputed per object or instance, see object_transforms.h
+struct ObjectTransforms {
+    mat4 model;
+    mat4 modelViewProjection;
+    mat3 normalMatrix;
+};
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
+#ifdef INSTANCED
+// Transforms of the visible instances, see instance_buffer.h. A draw covers
+// the ones from firstInstance on
+layout (std430, binding = 2) readonly buffer InstanceTransforms {
+    ObjectTransforms instances[];
+};
+uniform int firstInstance;
+#else
+layout (std140, binding = 2) uniform ObjectBlock {
+    ObjectTransforms object;
+};
+#endif
+
+#ifdef PACKED_VERTICES
+uniform vec3 meshBoundsMin;
+uniform vec3 meshBoundsExtent;
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+// Normal, tangent and bitangent from the 32-bit tangent frame
+void decodeFrame(uint frame, out vec3 normal, out vec3 tangent, out vec3 bitangent) {
+    vec2 e = vec2(frame & 0xFFFu, (frame >> 12) & 0xFFFu) / 4095.0 * 2.0 - 1.0;
+    normal = octDecode(e);
+
+    float s = normal.z >= 0.0 ? 1.0 : -1.0;
+    float a = -1.0 / (s + normal.z);
+    float b = normal.x * normal.y * a;
+    vec3 b1 = vec3(1.0 + s * normal.x * normal.x * a, s * b, -s * normal.x);
+    vec3 b2 = vec3(b, s + normal.y * normal.y * a, -normal.y);
+
+    float angle = float((frame >> 24) & 0x7Fu) / 128.0 * 6.28318530718;
+    tangent = cos(angle) * b1 + sin(angle) * b2;
+    bitangent = cross(normal, tangent) * ((frame >> 31) != 0u ? -1.0 : 1.0);
+}
+#endif
 
 void main() {
+#ifdef INSTANCED
+    ObjectTransforms object = instances[firstInstance + gl_InstanceID];
+#endif
     TexCoord = aTexCoord;
 
-    vec3 FragPos = vec3(model * vec4(aPos, 1.0));
+#ifdef PACKED_VERTICES
+    vec3 position = meshBoundsMin + aPos.xyz * meshBoundsExtent;
+    vec3 normal, tangent, bitangent;
+    decodeFrame(aFrame, normal, tangent, bitangent);
+#else
+    vec3 position = aPos;
+    vec3 normal = aNormal;
+    vec3 tangent = aTangent;
+    vec3 bitangent = aBitangent;
+#endif
+
+    vec3 FragPos = vec3(object.model * vec4(position, 1.0));
 
-    mat3 NormalMat = mat3(transpose(inverse(model)));
+    mat3 NormalMat = object.normalMatrix;
 
-    vec3 T = normalize(NormalMat * aTangent);
-    vec3 B = normalize(NormalMat * aBitangent);
-    vec3 N = normalize(NormalMat * aNormal);
+    vec3 T = normalize(NormalMat * tangent);
+    vec3 B = normalize(NormalMat * bitangent);
+    vec3 N = normalize(NormalMat * normal);
     mat3 TBN = transpose(mat3(T, B, N));
 
-    tng.TangentLightPos = TBN * lightPos;
-    tng.TangentViewPos  = TBN * viewPos;
+    tng.TangentLightPos = TBN * light.position;
+    tng.TangentViewPos  = TBN * frame.viewPos;
     tng.TangentFragPos  = TBN * FragPos;
 
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = object.modelViewProjection * vec4(position, 1.0);
 }
@@ -1,10 +1,17 @@
 #version 450 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// See object_transforms.h and uniform_buffer.h
+struct ObjectTransforms {
+   mat4 model;
+   mat4 modelViewProjection;
+   mat3 normalMatrix;
+};
+
+layout (std140, binding = 2) uniform ObjectBlock {
+   ObjectTransforms object;
+};
 
 void main() {
-   gl_Position = projection * view * model * vec4(aPos, 1.0);
+   gl_Position = object.modelViewProjection * vec4(aPos, 1.0);
 }
@@ -0,0 +1,98 @@
+#include "staging_ring.h"
+
+// Project Libraries
+#include "debug.h"
+#include "gl_state.h"
+
+// Regions start on this boundary, which keeps SIMD stores aligned
+static constexpr size_t regionAlignment = 64;
+
+StagingRing::StagingRing(size_t capacity, GlState &glState)
+    : capacity(capacity), glState(glState) {
+   // Coherent, so that writes of the workers need no flush before the
+   // upload commands read them
+   const GLbitfield flags =
+       GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+   glCreateBuffers(1, &buffer);
+   glNamedBufferStorage(buffer, capacity, nullptr, flags);
+   mapping = static_cast<uint8_t *>(
+       glMapNamedBufferRange(buffer, 0, capacity, flags));
+   if (!mapping)
+      debugMsg("StagingRing", "Failed to map the staging buffer");
+}
+
+StagingRing::~StagingRing() {
+   regions.clear();
+   if (mapping)
+      glUnmapNamedBuffer(buffer);
+   glState.deleteBuffers(1, &buffer);
+}
+
+bool StagingRing::allocate(size_t size, StagingRegion &region) {
+   size = (size + regionAlignment - 1) / regionAlignment * regionAlignment;
+
+   std::lock_guard<std::mutex> lock(mutex);
+   if (!mapping || size == 0 || size > capacity)
+      return false;
+
+   // Free bytes run from head up to the oldest region in use, wrapping
+   // around the end. Bytes skipped at the end are free again once the
+   // wrapped region is reclaimed
+   size_t offset;
+   if (regions.empty()) {
+      offset = 0;
+   } else {
+      const size_t tail = regions.front().offset;
+      if (head > tail && head + size <= capacity)
+         offset = head;
+      else if (head > tail && size <= tail)
+         offset = 0;
+      else if (head < tail && head + size <= tail)
+         offset = head;
+      else
+         return false;
+   }
+
+   regions.push_back({offset, size, false, nullptr});
+   head = offset + size;
+   region = {offset, size, mapping + offset};
+   return true;
+}
+
+void StagingRing::retire(const StagingRegion &region) {
+   std::lock_guard<std::mutex> lock(mutex);
+   for (Region &candidate : regions) {
+      if (candidate.offset == region.offset && !candidate.retired) {
+         candidate.retired = true;
+         unfenced++;
+         return;
+      }
+   }
+}
+
+void StagingRing::fence() {
+   std::lock_guard<std::mutex> lock(mutex);
+   if (unfenced == 0)
+      return;
+
+   // One fence covers every upload of the batch
+   std::shared_ptr<__GLsync> sync(
+       glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0),
+       [](GLsync fence) { glDeleteSync(fence); });
+   for (Region &region : regions) {
+      if (region.retired && !region.fence)
+         region.fence = sync;
+   }
+   unfenced = 0;
+}
+
+void StagingRing::reclaim() {
+   std::lock_guard<std::mutex> lock(mutex);
+   while (!regions.empty() && regions.front().fence) {
+      const GLenum status =
+          glClientWaitSync(regions.front().fence.get(), 0, 0);
+      if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+         break;
+      regions.pop_front();
+   }
+}
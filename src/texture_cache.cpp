@@ -0,0 +1,530 @@
+#include "texture_cache.h"
+
+// C++ Libraries
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+
+// Project Libraries
+#include "debug.h"
+#include "gl_state.h"
+
+/// Same spelling for every path of a file, e.g. "a/../b.png" and "b.png"
+static std::string canonicalPath(const std::string &path) {
+   std::error_code error;
+   std::filesystem::path canonical =
+       std::filesystem::weakly_canonical(path, error);
+   if (error)
+      canonical = std::filesystem::path(path).lexically_normal();
+   return canonical.string();
+}
+
+/// Internal format of the array an image goes into, sRGB formats decode
+/// the colors to linear when sampled
+static GLenum imageArrayFormat(const DecodedImage &image, bool srgb) {
+   if (image.compressed.empty())
+      return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+   return blockInternalFormat(image.compressed.format, srgb);
+}
+
+/// Levels the loader staged, blocks or RGBA8
+static const std::vector<ImageLevel> &stagedLevels(const DecodedImage &image) {
+   return image.compressed.empty() ? image.mips.levels
+                                   : image.compressed.levels;
+}
+
+static GLsizei levelSize(GLsizei size, GLsizei level) {
+   return std::max(size >> level, 1);
+}
+
+TextureCache::TextureCache(TextureLoader &textureLoader, GlState &glState)
+    : textureLoader(textureLoader), glState(glState) {}
+
+TextureCache::~TextureCache() {
+   for (const TextureArray &array : arrays)
+      glState.deleteTextures(1, &array.texture);
+}
+
+/// --- References ---
+TextureHandle TextureCache::acquire(const std::string &path,
+                                    TextureKind kind, bool srgb) {
+   stats.requests++;
+
+   const std::string canonical = canonicalPath(path);
+   const auto found = entryOfPath.find(canonical);
+   if (found != entryOfPath.end()) {
+      stats.pathHits++;
+      entries[found->second].references++;
+      return found->second;
+   }
+
+   debugMsg("file", canonical);
+
+   TextureHandle texture;
+   if (!freeEntries.empty()) {
+      texture = freeEntries.back();
+      freeEntries.pop_back();
+   } else {
+      texture = static_cast<TextureHandle>(entries.size());
+      entries.emplace_back();
+   }
+
+   Entry &entry = entries[texture];
+   entry = Entry();
+   entry.path = canonical;
+   entry.references = 1;
+   entry.kind = kind;
+   entry.srgb = srgb;
+   entry.loading = true;
+   entryOfPath[canonical] = texture;
+
+   textureLoader.load(
+       canonical,
+       [this, texture](const DecodedImage &image) { place(texture, image); },
+       kind);
+   return texture;
+}
+
+void TextureCache::release(TextureHandle texture) {
+   Entry &entry = entries[texture];
+   if (entry.references == 0 || --entry.references > 0)
+      return;
+
+   // The upload in flight still refers to the entry, it drops it
+   if (!entry.loading)
+      dropEntry(texture);
+}
+
+void TextureCache::dropEntry(TextureHandle texture) {
+   Entry &entry = entries[texture];
+   if (entry.image != noImage)
+      releaseImage(entry.image);
+
+   entryOfPath.erase(entry.path);
+   entry = Entry();
+   freeEntries.push_back(texture);
+}
+
+GLuint TextureCache::getArray(TextureHandle texture) const {
+   const GLuint image = entries[texture].image;
+   return image == noImage ? 0 : arrays[images[image].array].texture;
+}
+
+GLuint TextureCache::getLayer(TextureHandle texture) const {
+   const GLuint image = entries[texture].image;
+   return image == noImage ? 0 : images[image].layer;
+}
+
+size_t TextureCache::addListener(TextureListener listener) {
+   listeners.push_back({nextListener, std::move(listener)});
+   return nextListener++;
+}
+
+void TextureCache::removeListener(size_t id) {
+   listeners.erase(std::remove_if(listeners.begin(), listeners.end(),
+                                  [id](const auto &listener) {
+                                     return listener.first == id;
+                                  }),
+                   listeners.end());
+}
+
+/// --- Residency ---
+void TextureCache::place(TextureHandle texture, const DecodedImage &decoded) {
+   // Maps that failed to load stay missing
+   entries[texture].loading = false;
+   if (entries[texture].references == 0 || stagedLevels(decoded).empty()) {
+      if (entries[texture].references == 0)
+         dropEntry(texture);
+      return;
+   }
+
+   // Another path with the same contents is already resident, share it.
+   // Size and format guard against hash collisions
+   GLuint image = noImage;
+   const bool srgb = entries[texture].srgb;
+   const auto found = imageOfHash.find(decoded.hash);
+   if (found != imageOfHash.end()) {
+      const Image &candidate = images[found->second];
+      if (candidate.width == decoded.width &&
+          candidate.height == decoded.height &&
+          candidate.format == imageArrayFormat(decoded, srgb))
+         image = found->second;
+   }
+
+   if (image != noImage) {
+      stats.contentHits++;
+   } else {
+      image = allocateImage(decoded, entries[texture].kind, srgb);
+      stats.uploads++;
+   }
+
+   images[image].references++;
+   entries[texture].image = image;
+
+   for (const auto &listener : listeners)
+      listener.second(texture);
+}
+
+GLuint TextureCache::allocateImage(const DecodedImage &decoded,
+                                   TextureKind kind, bool srgb) {
+   GLuint image;
+   if (!freeImages.empty()) {
+      image = freeImages.back();
+      freeImages.pop_back();
+   } else {
+      image = static_cast<GLuint>(images.size());
+      images.emplace_back();
+   }
+
+   Image &allocated = images[image];
+   allocated = Image();
+   allocated.hash = decoded.hash;
+   allocated.width = decoded.width;
+   allocated.height = decoded.height;
+   allocated.levels = GLsizei(stagedLevels(decoded).size());
+   allocated.format = imageArrayFormat(decoded, srgb);
+   allocated.serial = nextSerial++;
+   allocated.path = decoded.path;
+   allocated.kind = kind;
+   allocated.srgb = srgb;
+
+   // While streaming only the coarse levels are uploaded, the finer ones
+   // are loaded again once they are requested
+   const GLsizei level =
+       startLevel(allocated.width, allocated.height, allocated.levels);
+   allocated.wantedLevel = level;
+   placeLayer(allocated, level);
+   uploadLayer(allocated, decoded);
+   residentBytes += imageBytes(allocated, level);
+
+   imageOfHash[decoded.hash] = image;
+   return image;
+}
+
+void TextureCache::releaseImage(GLuint image) {
+   Image &released = images[image];
+   if (--released.references > 0)
+      return;
+
+   // The layer keeps its pixels until it is reused, nothing samples it. A
+   // reload in flight finds the image gone
+   freeLayer(released.array, released.layer);
+   residentBytes -= imageBytes(released, released.residentLevel);
+   released.streamingLevel = noLevel;
+   const auto found = imageOfHash.find(released.hash);
+   if (found != imageOfHash.end() && found->second == image)
+      imageOfHash.erase(found);
+   freeImages.push_back(image);
+}
+
+/// --- Streaming ---
+void TextureCache::setBudget(size_t bytes) {
+   budget = bytes;
+   for (Image &image : images)
+      image.streamFailed = false;
+}
+
+void TextureCache::request(TextureHandle texture, float pixels) {
+   const GLuint image = entries[texture].image;
+   if (budget == 0 || image == noImage)
+      return;
+
+   Image &requested = images[image];
+   const GLsizei size = std::max(requested.width, requested.height);
+   GLsizei level = 0;
+   while (level + 1 < requested.levels &&
+          float(levelSize(size, level + 1)) >= pixels)
+      level++;
+
+   requested.wantedLevel = std::min(requested.wantedLevel, level);
+   requested.lastRequested = frame;
+}
+
+void TextureCache::stream() {
+   if (budget == 0)
+      return;
+
+   // Maps lacking the most levels first, then the most recently requested
+   std::vector<GLuint> lacking;
+   for (GLuint image = 0; image < images.size(); image++) {
+      const Image &candidate = images[image];
+      if (candidate.references > 0 && candidate.streamingLevel == noLevel &&
+          !candidate.streamFailed &&
+          candidate.wantedLevel < candidate.residentLevel)
+         lacking.push_back(image);
+   }
+   std::sort(lacking.begin(), lacking.end(), [this](GLuint a, GLuint b) {
+      const GLsizei missingA = images[a].residentLevel - images[a].wantedLevel;
+      const GLsizei missingB = images[b].residentLevel - images[b].wantedLevel;
+      if (missingA != missingB)
+         return missingA > missingB;
+      return images[a].lastRequested > images[b].lastRequested;
+   });
+
+   for (GLuint image : lacking) {
+      if (streams == maxStreams)
+         break;
+
+      Image &streaming = images[image];
+      const size_t needed = imageBytes(streaming, streaming.wantedLevel) -
+                            imageBytes(streaming, streaming.residentLevel);
+      if (residentBytes + streamingBytes + needed > budget &&
+          !evict(needed, image))
+         continue;
+
+      // The file is decoded again, repeat loads of compressed maps read
+      // their blocks from the cache
+      streaming.streamingLevel = streaming.wantedLevel;
+      streamingBytes += needed;
+      streams++;
+      textureLoader.load(
+          streaming.path,
+          [this, image, serial = streaming.serial,
+           needed](const DecodedImage &decoded) {
+             streamed(image, serial, needed, decoded);
+          },
+          streaming.kind);
+   }
+
+   // Maps nothing requests fall back to their start levels
+   for (Image &image : images)
+      image.wantedLevel = startLevel(image.width, image.height, image.levels);
+   frame++;
+}
+
+void TextureCache::streamed(GLuint image, uint64_t serial, size_t reserved,
+                            const DecodedImage &decoded) {
+   streams--;
+   streamingBytes -= reserved;
+
+   Image &streaming = images[image];
+   if (streaming.serial != serial || streaming.references == 0 ||
+       streaming.streamingLevel == noLevel)
+      return;
+
+   const GLsizei level = streaming.streamingLevel;
+   streaming.streamingLevel = noLevel;
+   if (decoded.hash != streaming.hash ||
+       imageArrayFormat(decoded, streaming.srgb) != streaming.format ||
+       GLsizei(stagedLevels(decoded).size()) != streaming.levels) {
+      debugMsg("Texture cache", "Failed to stream in " + streaming.path);
+      streaming.streamFailed = true;
+      return;
+   }
+
+   const size_t array = streaming.array;
+   const GLuint layer = streaming.layer;
+   const size_t bytes = imageBytes(streaming, streaming.residentLevel);
+   placeLayer(streaming, level);
+   uploadLayer(streaming, decoded);
+   freeLayer(array, layer);
+   residentBytes += imageBytes(streaming, level) - bytes;
+
+   stats.streamedIn++;
+   notify(image);
+}
+
+bool TextureCache::evict(size_t needed, GLuint keep) {
+   // Maps holding finer levels than requested, least recently requested
+   // first
+   std::vector<GLuint> finer;
+   for (GLuint image = 0; image < images.size(); image++) {
+      const Image &candidate = images[image];
+      if (image != keep && candidate.references > 0 &&
+          candidate.streamingLevel == noLevel &&
+          candidate.residentLevel < candidate.wantedLevel)
+         finer.push_back(image);
+   }
+   std::sort(finer.begin(), finer.end(), [this](GLuint a, GLuint b) {
+      return images[a].lastRequested < images[b].lastRequested;
+   });
+
+   for (GLuint image : finer) {
+      if (residentBytes + streamingBytes + needed <= budget)
+         break;
+      relocate(image, images[image].wantedLevel);
+   }
+   return residentBytes + streamingBytes + needed <= budget;
+}
+
+void TextureCache::relocate(GLuint image, GLsizei level) {
+   Image &moved = images[image];
+   const size_t array = moved.array;
+   const GLuint layer = moved.layer;
+   const GLsizei resident = moved.residentLevel;
+   const size_t bytes = imageBytes(moved, resident);
+   placeLayer(moved, level);
+
+   // The coarser levels stay on the GPU, they are copied into the layer of
+   // the smaller array
+   const GLuint from = arrays[array].texture;
+   const GLuint to = arrays[moved.array].texture;
+   for (GLsizei i = level; i < moved.levels; i++) {
+      glCopyImageSubData(from, GL_TEXTURE_2D_ARRAY, i - resident, 0, 0, layer,
+                         to, GL_TEXTURE_2D_ARRAY, i - level, 0, 0, moved.layer,
+                         levelSize(moved.width, i), levelSize(moved.height, i),
+                         1);
+   }
+   freeLayer(array, layer);
+   residentBytes -= bytes - imageBytes(moved, level);
+
+   stats.streamedOut++;
+   notify(image);
+}
+
+void TextureCache::notify(GLuint image) {
+   for (TextureHandle texture = 0; texture < entries.size(); texture++) {
+      if (entries[texture].image != image)
+         continue;
+      for (const auto &listener : listeners)
+         listener.second(texture);
+   }
+}
+
+GLsizei TextureCache::startLevel(GLsizei width, GLsizei height,
+                                 GLsizei levels) const {
+   GLsizei level = 0;
+   if (budget == 0)
+      return level;
+   while (level + 1 < levels &&
+          std::max(width, height) >> level > streamStartSize)
+      level++;
+   return level;
+}
+
+size_t TextureCache::imageBytes(const Image &image, GLsizei level) {
+   const bool bc1 = image.format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ||
+                    image.format == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+   size_t bytes = 0;
+   for (; level < image.levels; level++) {
+      const size_t width = size_t(levelSize(image.width, level));
+      const size_t height = size_t(levelSize(image.height, level));
+      if (image.format == GL_RGBA8 || image.format == GL_SRGB8_ALPHA8)
+         bytes += width * height * 4;
+      else
+         bytes += ((width + 3) / 4) * ((height + 3) / 4) * (bc1 ? 8 : 16);
+   }
+   return bytes;
+}
+
+/// --- Layers ---
+void TextureCache::placeLayer(Image &image, GLsizei level) {
+   image.array = findArray(levelSize(image.width, level),
+                           levelSize(image.height, level), image.format);
+   image.residentLevel = level;
+
+   TextureArray &array = arrays[image.array];
+   if (!array.freeLayers.empty()) {
+      image.layer = array.freeLayers.back();
+      array.freeLayers.pop_back();
+   } else {
+      if (array.layers == array.capacity)
+         grow(array);
+      image.layer = array.layers++;
+   }
+}
+
+void TextureCache::uploadLayer(const Image &image,
+                               const DecodedImage &decoded) {
+   // Data comes from the loader's upload buffer, level by level as the
+   // workers filtered it
+   const TextureArray &array = arrays[image.array];
+   const std::vector<ImageLevel> &levels = stagedLevels(decoded);
+   for (GLsizei i = image.residentLevel; i < GLsizei(levels.size()); i++) {
+      const ImageLevel &level = levels[i];
+      const GLint index = i - image.residentLevel;
+      if (!decoded.compressed.empty()) {
+         glCompressedTextureSubImage3D(
+             array.texture, index, 0, 0, image.layer, level.width,
+             level.height, 1, array.format, GLsizei(level.size),
+             (void *)level.offset);
+      } else {
+         glTextureSubImage3D(array.texture, index, 0, 0, image.layer,
+                             level.width, level.height, 1, GL_RGBA,
+                             GL_UNSIGNED_BYTE, (void *)level.offset);
+      }
+   }
+}
+
+void TextureCache::freeLayer(size_t index, GLuint layer) {
+   TextureArray &array = arrays[index];
+   array.freeLayers.push_back(layer);
+   if (GLsizei(array.freeLayers.size()) < array.layers)
+      return;
+
+   // Streaming leaves arrays of many sizes behind, empty ones go
+   glState.deleteTextures(1, &array.texture);
+   array.texture = 0;
+   array.layers = 0;
+   array.capacity = 0;
+   array.freeLayers.clear();
+}
+
+size_t TextureCache::findArray(int width, int height, GLenum format) {
+   const auto found = arrayOfSize.find({width, height, format});
+   if (found != arrayOfSize.end())
+      return found->second;
+
+   TextureArray array;
+   array.format = format;
+   array.width = width;
+   array.height = height;
+   array.levels = 1;
+   while ((std::max(width, height) >> array.levels) > 0)
+      array.levels++;
+
+   arrayOfSize[{width, height, format}] = arrays.size();
+   arrays.push_back(array);
+   return arrays.size() - 1;
+}
+
+void TextureCache::grow(TextureArray &array) {
+   const GLsizei capacity = std::max<GLsizei>(array.capacity * 2, 4);
+
+   GLuint texture;
+   glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texture);
+   glTextureStorage3D(texture, array.levels, array.format, array.width,
+                      array.height, capacity);
+   glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+   glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+   glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+   glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+   // Layers stay where they are, every level is copied on the GPU
+   if (array.texture) {
+      for (GLsizei level = 0; level < array.levels; level++) {
+         glCopyImageSubData(array.texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                            texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                            std::max(array.width >> level, 1),
+                            std::max(array.height >> level, 1), array.layers);
+      }
+      glState.deleteTextures(1, &array.texture);
+   }
+
+   array.texture = texture;
+   array.capacity = capacity;
+}
+
+void TextureCache::report() const {
+   size_t layers = 0, allocated = 0;
+   for (const TextureArray &array : arrays) {
+      layers += array.layers - array.freeLayers.size();
+      allocated += array.texture ? 1 : 0;
+   }
+
+   char line[160];
+   std::snprintf(line, sizeof(line),
+                 "%zu requests, %zu path hits, %zu content hits, %zu "
+                 "uploads, %zu layers in %zu arrays",
+                 stats.requests, stats.pathHits, stats.contentHits,
+                 stats.uploads, layers, allocated);
+   debugMsg("Texture cache", line);
+
+   if (budget == 0)
+      return;
+   std::snprintf(line, sizeof(line),
+                 "%zu of %zu KiB resident, %zu maps streamed in, %zu out",
+                 residentBytes / 1024, budget / 1024, stats.streamedIn,
+                 stats.streamedOut);
+   debugMsg("Texture streaming", line);
+}
@@ -0,0 +1,307 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include "texture_loader.h"
+
+GLenum imageFormat(int components) {
+   if (components == 1)
+      return GL_RED;
+   if (components == 2)
+      return GL_RG;
+   if (components == 3)
+      return GL_RGB;
+   return GL_RGBA;
+}
+
+/// Bytes of the staged data, blocks or mips replace the pixels
+static size_t stagedSize(const DecodedImage &image) {
+   if (image.staging)
+      return image.staging.size;
+   if (!image.compressed.empty())
+      return image.compressed.data.size();
+   if (!image.mips.empty())
+      return image.mips.data.size();
+   return size_t(image.width) * image.height * image.components;
+}
+
+static const void *stagedData(const DecodedImage &image) {
+   if (!image.compressed.empty())
+      return image.compressed.data.data();
+   if (!image.mips.empty())
+      return image.mips.data.data();
+   return image.pixels;
+}
+
+/// The image as its requester sees a failed load, without any data
+static DecodedImage failedImage(const DecodedImage &image) {
+   DecodedImage failed;
+   failed.texture = image.texture;
+   failed.path = image.path;
+   failed.hash = image.hash;
+   return failed;
+}
+
+TextureLoader::TextureLoader(ThreadPool &pool, GlState &glState,
+                             size_t queueCapacity, size_t stagingCapacity)
+    : pool(pool), glState(glState), decoded(queueCapacity),
+      staging(stagingCapacity, glState) {
+   // Rows bottom up, as glTexImage2D expects them
+   stbi_set_flip_vertically_on_load(true);
+   glCreateBuffers(1, &PBO);
+
+   GLint extensions = 0;
+   glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+   for (GLint i = 0; i < extensions; i++) {
+      const char *name =
+          reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+      if (name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+         s3tc = true;
+   }
+}
+
+TextureLoader::~TextureLoader() {
+   // Workers still push into the queue, drain it until they are done
+   DecodedImage image;
+   while (pending.load() > 0) {
+      if (pop(image)) {
+         stbi_image_free(image.pixels);
+         pending--;
+      } else {
+         std::this_thread::yield();
+      }
+   }
+
+   glState.deleteBuffers(1, &PBO);
+}
+
+GLuint TextureLoader::load(const std::string &filename, bool normalMap) {
+   GLuint textureID;
+   glCreateTextures(GL_TEXTURE_2D, 1, &textureID);
+
+   // Placeholder: neutral grey, or a flat normal for normal maps
+   const GLubyte grey[4] = {128, 128, 128, 255};
+   const GLubyte flat[4] = {128, 128, 255, 255};
+
+   // glTexImage2D has no DSA form, the active unit is always 0
+   glState.bindTextureUnit(0, textureID);
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                normalMap ? flat : grey);
+   glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+   glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+   glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+   glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+   pending++;
+   pool.submit([this, textureID, filename]() {
+      decode(textureID, nullptr, filename, TextureKind::Color, false);
+   });
+
+   return textureID;
+}
+
+void TextureLoader::load(const std::string &filename, ImageUpload upload,
+                         TextureKind kind) {
+   pending++;
+   pool.submit([this, upload, filename, kind, compress = compression]() {
+      decode(0, upload, filename, kind, compress);
+   });
+}
+
+void TextureLoader::decode(GLuint texture, ImageUpload upload,
+                           std::string filename, TextureKind kind,
+                           bool compress) {
+   DecodedImage image;
+   image.texture = texture;
+   image.upload = std::move(upload);
+   image.path = filename;
+
+   // Hashed and decoded from the same mapping, the file is read once
+   MappedFile file;
+   if (file.open(filename)) {
+      image.hash = hashBytes(file.data(), file.size());
+
+      // Blocks compressed by an earlier run, if their format is still the
+      // one this kind and context would get. They are copied from the
+      // mapping into the ring, nothing is read into the heap
+      MappedFile cache;
+      const uint8_t *blocks =
+          compress ? DdsCache::map(filename, image.hash, cache,
+                                   image.compressed)
+                   : nullptr;
+      const BlockFormat format = image.compressed.format;
+      if (blocks && format == chooseBlockFormat(
+                                  kind, format == BlockFormat::BC3, s3tc)) {
+         image.width = image.compressed.levels[0].width;
+         image.height = image.compressed.levels[0].height;
+         image.components = 4;
+         stageBlocks(image, blocks);
+      } else {
+         image.compressed = CompressedImage();
+         image.pixels = stbi_load_from_memory(
+             file.data(), static_cast<int>(file.size()), &image.width,
+             &image.height, &image.components, image.upload ? 4 : 0);
+      }
+   }
+
+   // Textures of their own still generate their mipmaps on the GPU
+   if (image.pixels && image.upload) {
+      image.components = 4;
+      generateLevels(image, kind, compress);
+   }
+
+   // The GL thread drains the queue every frame, until then a full queue
+   // spills into the overflow
+   if (!decoded.push(std::move(image))) {
+      std::lock_guard<std::mutex> lock(overflowMutex);
+      overflow.push_back(std::move(image));
+      overflowSize++;
+   }
+}
+
+bool TextureLoader::pop(DecodedImage &image) {
+   if (decoded.pop(image))
+      return true;
+   if (overflowSize.load() == 0)
+      return false;
+
+   std::lock_guard<std::mutex> lock(overflowMutex);
+   if (overflow.empty())
+      return false;
+   image = std::move(overflow.front());
+   overflow.pop_front();
+   overflowSize--;
+   return true;
+}
+
+size_t TextureLoader::upload(size_t byteBudget) {
+   size_t uploaded = 0;
+   size_t spent = 0;
+
+   // Ring regions whose uploads the GPU finished take new levels
+   staging.reclaim();
+
+   DecodedImage image;
+   bool bound = false;
+   while (spent < byteBudget && pop(image)) {
+      const bool loaded =
+          image.pixels || !image.mips.empty() || !image.compressed.empty();
+      if (loaded)
+         bound = true;
+
+      if (loaded && uploadImage(image)) {
+         spent += stagedSize(image);
+         uploaded++;
+      } else {
+         if (!loaded)
+            debugMsg("Texture", "Failed to load image data " + image.path);
+         // The requester still learns that the load is over
+         if (image.upload)
+            image.upload(failedImage(image));
+      }
+
+      if (image.staging)
+         staging.retire(image.staging);
+
+      stbi_image_free(image.pixels);
+      pending--;
+   }
+
+   // Unpacking from client memory again, the cache skips this when idle
+   if (bound) {
+      staging.fence();
+      glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      glState.setUnpackAlignment(4);
+   }
+
+   return uploaded;
+}
+
+bool TextureLoader::uploadImage(const DecodedImage &image) {
+   const GLenum format = imageFormat(image.components);
+
+   if (image.staging) {
+      // The worker already wrote the levels where GL reads them
+      glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.getBuffer());
+   } else {
+      // Orphan the previous storage so the copy never waits on the GPU
+      const size_t size = stagedSize(image);
+      glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, PBO);
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+      void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                      GL_MAP_WRITE_BIT |
+                                          GL_MAP_INVALIDATE_BUFFER_BIT);
+      if (!mapped) {
+         debugMsg("Texture", "Failed to map upload buffer for " + image.path);
+         return false;
+      }
+      std::memcpy(mapped, stagedData(image), size);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+   }
+
+   // Rows of RGB and single channel images are not 4 byte aligned
+   glState.setUnpackAlignment(1);
+
+   if (image.upload) {
+      image.upload(image);
+   } else {
+      glState.bindTextureUnit(0, image.texture);
+      glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0,
+                   format, GL_UNSIGNED_BYTE, (void *)0);
+      glGenerateTextureMipmap(image.texture);
+      glTextureParameteri(image.texture, GL_TEXTURE_MIN_FILTER,
+                          GL_LINEAR_MIPMAP_LINEAR);
+   }
+   return true;
+}
+
+void TextureLoader::generateLevels(DecodedImage &image, TextureKind kind,
+                                   bool compress) {
+   // Block rows and columns must not straddle the edge of an array layer
+   const bool blocks =
+       compress && image.width % 4 == 0 && image.height % 4 == 0;
+
+   // RGBA8 levels are filtered straight into the ring if it has room
+   const std::vector<ImageLevel> levels =
+       mipChainLevels(image.width, image.height);
+   if (!blocks && staging.allocate(levels.back().offset + levels.back().size,
+                                   image.staging)) {
+      generateMipChainInto(image.pixels, image.width, image.height, kind,
+                           image.staging.data, &pool);
+      image.mips.levels = levels;
+      for (ImageLevel &level : image.mips.levels)
+         level.offset += image.staging.offset;
+   } else {
+      image.mips = generateMipChain(image.pixels, image.width, image.height,
+                                    kind, &pool);
+   }
+   stbi_image_free(image.pixels);
+   image.pixels = nullptr;
+   if (!blocks)
+      return;
+
+   bool hasAlpha = false;
+   const size_t texels = size_t(image.width) * image.height;
+   for (size_t i = 0; i < texels && !hasAlpha; i++)
+      hasAlpha = image.mips.data[i * 4 + 3] != 255;
+
+   // The cache file is written from the heap, mapped buffers are slow to
+   // read back
+   const BlockFormat format = chooseBlockFormat(kind, hasAlpha, s3tc);
+   image.compressed = compressMipChain(image.mips, format);
+   image.mips = MipChain();
+   DdsCache::write(image.path, image.hash, image.compressed);
+   stageBlocks(image, image.compressed.data.data());
+}
+
+void TextureLoader::stageBlocks(DecodedImage &image, const uint8_t *blocks) {
+   const ImageLevel &last = image.compressed.levels.back();
+   const size_t size = last.offset + last.size;
+   if (!staging.allocate(size, image.staging)) {
+      if (image.compressed.data.empty())
+         image.compressed.data.assign(blocks, blocks + size);
+      return;
+   }
+
+   std::memcpy(image.staging.data, blocks, size);
+   for (ImageLevel &level : image.compressed.levels)
+      level.offset += image.staging.offset;
+   image.compressed.data = std::vector<uint8_t>();
+}
@@ -0,0 +1,37 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(size_t threadCount) {
+   if (threadCount == 0)
+      threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+   workers.reserve(threadCount);
+   for (size_t i = 0; i < threadCount; i++)
+      workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool() {
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+   }
+   condition.notify_all();
+
+   for (std::thread &worker : workers)
+      worker.join();
+}
+
+void ThreadPool::work() {
+   while (true) {
+      std::function<void()> task;
+      {
+         std::unique_lock<std::mutex> lock(mutex);
+         condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+         if (stopping && tasks.empty())
+            return;
+
+         task = std::move(tasks.front());
+         tasks.pop();
+      }
+      task();
+   }
+}
@@ -0,0 +1,88 @@
+#include "uniform_buffer.h"
+
+// C++ Libraries
+#include <cstring>
+
+// Project Libraries
+#include "gl_state.h"
+
+static GLsizeiptr alignUp(GLsizeiptr size, GLsizeiptr alignment) {
+   return (size + alignment - 1) / alignment * alignment;
+}
+
+UniformBuffer::UniformBuffer(size_t objectCapacity, GlState &glState)
+    : objectCapacity(objectCapacity), glState(glState) {
+   // Blocks are bound as ranges, their offsets have to be aligned
+   GLint alignment = 1;
+   glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+   frameSize = alignUp(sizeof(FrameBlock), alignment);
+   lightSize = alignUp(sizeof(LightBlock), alignment);
+   objectSize = alignUp(sizeof(ObjectBlock), alignment);
+   regionSize = frameSize + lightSize + objectSize * objectCapacity;
+
+   const GLbitfield flags =
+       GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+   glCreateBuffers(1, &buffer);
+   glNamedBufferStorage(buffer, regionSize * uniformBufferRegions, nullptr,
+                        flags);
+   mapped = static_cast<char *>(glMapNamedBufferRange(
+       buffer, 0, regionSize * uniformBufferRegions, flags));
+}
+
+UniformBuffer::~UniformBuffer() {
+   for (GLsync fence : fences) {
+      if (fence)
+         glDeleteSync(fence);
+   }
+
+   glUnmapNamedBuffer(buffer);
+   glState.deleteBuffers(1, &buffer);
+}
+
+void UniformBuffer::begin() {
+   region = (region + 1) % uniformBufferRegions;
+
+   // Usually signaled long ago, the GPU is at most a few frames behind
+   GLsync &fence = fences[region];
+   if (fence) {
+      GLenum status = GL_TIMEOUT_EXPIRED;
+      while (status == GL_TIMEOUT_EXPIRED)
+         status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                   1000000);
+      glDeleteSync(fence);
+      fence = nullptr;
+   }
+}
+
+void UniformBuffer::setFrame(const FrameBlock &frame) {
+   const GLsizeiptr offset = regionOffset();
+   std::memcpy(mapped + offset, &frame, sizeof(FrameBlock));
+   glState.bindBufferRange(GL_UNIFORM_BUFFER, frameBlockBinding, buffer,
+                           offset, sizeof(FrameBlock));
+}
+
+void UniformBuffer::setLight(const LightBlock &light) {
+   const GLsizeiptr offset = regionOffset() + frameSize;
+   std::memcpy(mapped + offset, &light, sizeof(LightBlock));
+   glState.bindBufferRange(GL_UNIFORM_BUFFER, lightBlockBinding, buffer,
+                           offset, sizeof(LightBlock));
+}
+
+void UniformBuffer::setObject(size_t index, const ObjectBlock &object) {
+   const GLsizeiptr offset =
+       regionOffset() + frameSize + lightSize + objectSize * index;
+   std::memcpy(mapped + offset, &object, sizeof(ObjectBlock));
+}
+
+void UniformBuffer::bindObject(size_t index) const {
+   const GLsizeiptr offset =
+       regionOffset() + frameSize + lightSize + objectSize * index;
+   glState.bindBufferRange(GL_UNIFORM_BUFFER, objectBlockBinding, buffer,
+                           offset, sizeof(ObjectBlock));
+}
+
+void UniformBuffer::fence() {
+   if (fences[region])
+      glDeleteSync(fences[region]);
+   fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
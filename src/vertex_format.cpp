@@ -0,0 +1,142 @@
+#include "vertex_format.h"
+
+// Graphics Libraries
+#include <glm/gtc/packing.hpp>
+
+// C++ Libraries
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+static const float twoPi = 6.28318530718f;
+
+/// --- Octahedral Encoding ---
+static glm::vec2 octEncode(glm::vec3 n) {
+   n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+   glm::vec2 e(n.x, n.y);
+   if (n.z < 0.0f) {
+      e = (1.0f - glm::abs(glm::vec2(n.y, n.x))) *
+          glm::vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+   }
+   return e;
+}
+
+// Must match octDecode in the model shaders
+static glm::vec3 octDecode(glm::vec2 e) {
+   glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+   if (n.z < 0.0f) {
+      glm::vec2 xy = (1.0f - glm::abs(glm::vec2(n.y, n.x))) *
+                     glm::vec2(n.x >= 0.0f ? 1.0f : -1.0f,
+                               n.y >= 0.0f ? 1.0f : -1.0f);
+      n.x = xy.x;
+      n.y = xy.y;
+   }
+   return glm::normalize(n);
+}
+
+// Orthonormal basis around n (Duff et al. 2017), must match the shaders
+static void orthonormalBasis(const glm::vec3 &n, glm::vec3 &b1,
+                             glm::vec3 &b2) {
+   float sign = n.z >= 0.0f ? 1.0f : -1.0f;
+   float a = -1.0f / (sign + n.z);
+   float b = n.x * n.y * a;
+   b1 = glm::vec3(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+   b2 = glm::vec3(b, sign + n.y * n.y * a, -n.y);
+}
+
+uint32_t packTangentFrame(const glm::vec3 &normal, const glm::vec3 &tangent,
+                          const glm::vec3 &bitangent) {
+   glm::vec3 n = normal;
+   if (!(glm::dot(n, n) > 1e-12f))
+      n = glm::vec3(0.0f, 0.0f, 1.0f);
+
+   // Normal, quantized to 12 bits per component
+   glm::vec2 e = octEncode(n);
+   uint32_t u = uint32_t(std::lround((e.x * 0.5f + 0.5f) * 4095.0f));
+   uint32_t v = uint32_t(std::lround((e.y * 0.5f + 0.5f) * 4095.0f));
+
+   // The tangent angle is measured in the basis of the decoded normal, so
+   // that the shader reconstructs the same basis
+   glm::vec3 decoded =
+       octDecode(glm::vec2(u, v) / 4095.0f * 2.0f - glm::vec2(1.0f));
+   glm::vec3 b1, b2;
+   orthonormalBasis(decoded, b1, b2);
+
+   uint32_t angle = 0;
+   uint32_t sign = 0;
+   glm::vec3 t = tangent - decoded * glm::dot(decoded, tangent);
+   if (glm::dot(t, t) > 1e-12f && std::isfinite(glm::dot(t, t))) {
+      float radians = std::atan2(glm::dot(t, b2), glm::dot(t, b1));
+      if (radians < 0.0f)
+         radians += twoPi;
+      angle = uint32_t(std::lround(radians / twoPi * 128.0f)) & 0x7Fu;
+
+      if (glm::dot(glm::cross(decoded, t), bitangent) < 0.0f)
+         sign = 1;
+   }
+
+   return u | (v << 12) | (angle << 24) | (sign << 31);
+}
+
+std::vector<PackedVertex> packVertices(const Vertex *vertices, size_t count,
+                                       const glm::vec3 &boundsMin,
+                                       const glm::vec3 &boundsExtent) {
+   // Degenerate axes quantize to zero instead of dividing by zero
+   glm::vec3 scale(0.0f);
+   for (int axis = 0; axis < 3; axis++) {
+      if (boundsExtent[axis] > 0.0f)
+         scale[axis] = 65535.0f / boundsExtent[axis];
+   }
+
+   std::vector<PackedVertex> packed(count);
+   for (size_t i = 0; i < count; i++) {
+      const Vertex &vertex = vertices[i];
+      PackedVertex &out = packed[i];
+
+      glm::vec3 q = glm::clamp((vertex.Position - boundsMin) * scale,
+                               glm::vec3(0.0f), glm::vec3(65535.0f));
+      out.Position[0] = uint16_t(std::lround(q.x));
+      out.Position[1] = uint16_t(std::lround(q.y));
+      out.Position[2] = uint16_t(std::lround(q.z));
+      out.Position[3] = 0;
+
+      out.Frame =
+          packTangentFrame(vertex.Normal, vertex.Tangent, vertex.Bitangent);
+      out.TexCoords = glm::packHalf2x16(vertex.TexCoords);
+   }
+
+   return packed;
+}
+
+void vertexAttributes(GLuint VAO, GLuint binding, VertexFormat format) {
+   if (format == VertexFormat::Packed) {
+      // | Pos | Frm | Tex |
+      // |  0  |  1  |  2  |
+      glVertexArrayAttribFormat(VAO, 0, 4, GL_UNSIGNED_SHORT, GL_TRUE,
+                                offsetof(PackedVertex, Position));
+      glVertexArrayAttribIFormat(VAO, 1, 1, GL_UNSIGNED_INT,
+                                 offsetof(PackedVertex, Frame));
+      glVertexArrayAttribFormat(VAO, 2, 2, GL_HALF_FLOAT, GL_FALSE,
+                                offsetof(PackedVertex, TexCoords));
+
+      for (GLuint i = 0; i < 3; i++) {
+         glEnableVertexArrayAttrib(VAO, i);
+         glVertexArrayAttribBinding(VAO, i, binding);
+      }
+      return;
+   }
+
+   // | Pos | Nrm | Tex | Tng | Bng |
+   // |  0  |  1  |  2  |  3  |  4  |
+   const GLint sizes[] = {3, 3, 2, 3, 3};
+   const GLuint offsets[] = {
+       offsetof(Vertex, Position), offsetof(Vertex, Normal),
+       offsetof(Vertex, TexCoords), offsetof(Vertex, Tangent),
+       offsetof(Vertex, Bitangent)};
+   for (GLuint i = 0; i < 5; i++) {
+      glVertexArrayAttribFormat(VAO, i, sizes[i], GL_FLOAT, GL_FALSE,
+                                offsets[i]);
+      glEnableVertexArrayAttrib(VAO, i);
+      glVertexArrayAttribBinding(VAO, i, binding);
+   }
+}
@@ -0,0 +1,266 @@
+#include "viewer.h"
+
+// Graphics Libraries
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// C++ Libraries
+#include <algorithm>
+
+// Project Libraries
+#include "debug.h"
+#include "frustum.h"
+
+/// --- Helpers ---
+// Box around the transformed corners of bounds (Arvo)
+static Aabb transformBounds(const Aabb &bounds, const glm::mat4 &transform) {
+   const glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+   const glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+   const glm::vec3 worldCenter =
+       glm::vec3(transform * glm::vec4(center, 1.0f));
+   const glm::vec3 worldExtent = glm::abs(glm::vec3(transform[0])) * extent.x +
+                                 glm::abs(glm::vec3(transform[1])) * extent.y +
+                                 glm::abs(glm::vec3(transform[2])) * extent.z;
+   return {worldCenter - worldExtent, worldCenter + worldExtent};
+}
+
+Viewer::Viewer(const ViewerOptions &options, LoadProgress progress) {
+   std::vector<std::string> defines;
+   if (options.vertexFormat == VertexFormat::Packed)
+      defines.push_back(packedVerticesDefine);
+   if (options.gammaCorrection)
+      defines.push_back(gammaCorrectionDefine);
+
+   std::vector<std::string> instancedDefines = defines;
+   instancedDefines.push_back(instancedDefine);
+
+   // --- Create shader programs ---
+   ShaderPaths modelPaths = {"src/shaders/modelShader.vert",
+                             "src/shaders/modelShader.frag", defines};
+   modelPipeline = std::make_unique<ShaderPipeline>(modelPaths, glState);
+
+   ShaderPaths batchPaths = {"src/shaders/batchShader.vert",
+                             "src/shaders/batchShader.frag", defines};
+   batchPipeline = std::make_unique<ShaderPipeline>(batchPaths, glState);
+
+   ShaderPaths instancedPaths = {"src/shaders/modelShader.vert",
+                                 "src/shaders/modelShader.frag",
+                                 instancedDefines};
+   instancedPipeline =
+       std::make_unique<ShaderPipeline>(instancedPaths, glState);
+
+   ShaderPaths lightPaths = {"src/shaders/simpleShader.vert",
+                             "src/shaders/simpleShader.frag", {}};
+   lightPipeline = std::make_unique<ShaderPipeline>(lightPaths, glState);
+
+   // Uniform blocks shared by all pipelines
+   uniforms = std::make_unique<UniformBuffer>(2, glState);
+
+   // Create lamp
+   lamp =
+       std::make_unique<LightSource>(glm::vec3(1.2f, 1.0f, 2.0f), glState);
+
+   // Load model, textures decoded meanwhile are uploaded between meshes
+   textureLoader = std::make_unique<TextureLoader>(workers, glState);
+   (*textureLoader).setCompression(options.compressTextures);
+   textureCache = std::make_unique<TextureCache>(*textureLoader, glState);
+   (*textureCache).setBudget(options.textureBudget);
+   model = std::make_unique<Model>(
+       options.modelPath, workers, *textureCache, glState,
+       options.gammaCorrection, options.vertexFormat,
+       [this, progress](size_t uploaded, size_t total) {
+          (*textureLoader).upload();
+          if (progress)
+             progress(uploaded, total);
+       });
+   batch = std::make_unique<ModelBatch>(*model, glState);
+
+   // Instances, spaced so that neighbouring copies do not overlap
+   if (options.instanceGrid > 0) {
+      const int grid = options.instanceGrid;
+      const Aabb bounds = (*model).getBounds();
+      const float spacing = glm::length(bounds.max - bounds.min) * 1.25f;
+      const float offset = (grid - 1) * 0.5f;
+      for (int z = 0; z < grid; z++) {
+         for (int x = 0; x < grid; x++) {
+            instanceTransforms.push_back(glm::translate(
+                glm::mat4(1.0f),
+                glm::vec3((x - offset) * spacing, 0.0f, -z * spacing)));
+         }
+      }
+      instances = std::make_unique<InstanceBuffer>(
+          GLsizei(instanceTransforms.size()), glState);
+
+      for (const glm::mat4 &instance : instanceTransforms)
+         instanceBounds.push_back(transformBounds(bounds, instance));
+      instanceBvh.build(instanceBounds, &workers);
+   }
+
+   // --- Enable depth ---
+   glState.setEnabled(GL_DEPTH_TEST, true);
+}
+
+Viewer::~Viewer() {
+   // Meshes and textures before the loader, which drains the workers
+   instances.reset();
+   batch.reset();
+   model.reset();
+   textureCache.reset();
+   textureLoader.reset();
+}
+
+void Viewer::renderFrame(const Camera &camera, int width, int height,
+                         bool useBatch) {
+   glState.beginFrame();
+
+   // Stream in textures decoded since the last frame
+   {
+      ProfileScope scope("Texture upload");
+      (*textureLoader).upload();
+   }
+
+   // Clear window buffer
+   glClearColor(0.01f, 0.01f, 0.01f, 1.0f);
+   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+   // Transformations
+   const glm::mat4 transform = glm::mat4(1.0f);
+   const glm::mat4 view = camera.getView();
+   const float aspect = float(width) / float(std::max(height, 1));
+   const glm::mat4 projection = camera.getProjection(aspect, 0.1f, 100.0f);
+   const glm::mat4 viewProjection = projection * view;
+
+   glm::mat4 lampTransform = glm::translate(glm::mat4(1.0f), (*lamp).Position);
+   lampTransform = glm::scale(lampTransform, glm::vec3(0.2f));
+
+   // Everything the shaders read this frame, written once
+   {
+      ProfileScope scope("Uniforms");
+      (*uniforms).begin();
+      (*uniforms).setFrame(
+          {view, projection, glm::vec4(camera.Position, 1.0f)});
+      (*uniforms).setLight({glm::vec4((*lamp).Position, 1.0f),
+                            glm::vec4((*lamp).AmbientStrength, 0.0f),
+                            glm::vec4((*lamp).SpecularStrength, 0.0f),
+                            glm::vec4((*lamp).Color, 0.0f)});
+      (*uniforms).setObject(0,
+                            computeObjectTransforms(transform, viewProjection));
+      (*uniforms).setObject(
+          1, computeObjectTransforms(lampTransform, viewProjection));
+      lodSelector.update(projection, float(height));
+   }
+
+   // Enable shader program
+   ShaderPipeline &pipeline = instances  ? *instancedPipeline
+                              : useBatch ? *batchPipeline
+                                         : *modelPipeline;
+   pipeline.use();
+   (*uniforms).bindObject(0);
+
+   {
+      GpuProfileScope scope("Scene");
+      if (instances) {
+         if (instancesMoved) {
+            instanceBvh.refit(instanceBounds);
+            instancesMoved = false;
+         }
+
+         // Copies in subtrees fully inside of the view are taken as they
+         // are, those in leaves crossing a plane test the model bounds in
+         // their object space
+         const Aabb bounds = (*model).getBounds();
+         const std::vector<uint32_t> &order = instanceBvh.order();
+         const Frustum frustum(viewProjection);
+         visibleInstances.clear();
+         instanceBvh.cull(frustum, [&](uint32_t first, uint32_t count,
+                                       bool inside) {
+            for (uint32_t i = first; i < first + count; i++) {
+               const glm::mat4 &instance = instanceTransforms[order[i]];
+               if (inside || Frustum(viewProjection * instance)
+                                 .intersects(bounds.min, bounds.max))
+                  visibleInstances.push_back(instance);
+            }
+         });
+
+         // Nearest first, so that copies drawing the same level of a mesh
+         // are mostly next to each other
+         std::sort(visibleInstances.begin(), visibleInstances.end(),
+                   [&camera](const glm::mat4 &a, const glm::mat4 &b) {
+                      const glm::vec3 toA = glm::vec3(a[3]) - camera.Position;
+                      const glm::vec3 toB = glm::vec3(b[3]) - camera.Position;
+                      return glm::dot(toA, toA) < glm::dot(toB, toB);
+                   });
+
+         // Matrices of the visible copies in one batch, every mesh draws
+         // ranges of them
+         const GLsizei visible = GLsizei(visibleInstances.size());
+         computeObjectTransforms(visibleInstances.data(), visible,
+                                 viewProjection, (*instances).begin());
+         (*instances).end(visible);
+
+         // Map levels follow the nearest copy, which needs the most detail
+         if (visible > 0)
+            (*model).requestTextures(lodSelector, visibleInstances[0],
+                                     camera.Position);
+         renderQueue.clear();
+         (*model).enqueueInstances(renderQueue, pipeline, lodSelector,
+                                   visibleInstances, viewProjection,
+                                   camera.Position);
+         renderQueue.submit();
+         (*instances).fence();
+      } else {
+         // Skip meshes outside of the view, then pick the level of detail from
+         // the projected error of each mesh
+         (*model).cull(viewProjection, transform);
+         (*model).selectLods(lodSelector, transform, camera.Position);
+         (*model).requestTextures(lodSelector, transform, camera.Position);
+
+         if (useBatch) {
+            (*batch).updateDraws(*model);
+            (*batch).Draw();
+         } else {
+            renderQueue.clear();
+            (*model).enqueue(renderQueue, pipeline, transform,
+                             camera.Position);
+            renderQueue.submit();
+         }
+      }
+   }
+
+   // Same but for light
+   {
+      GpuProfileScope scope("Lamp");
+      (*lightPipeline).use();
+      (*uniforms).bindObject(1);
+      glState.setPolygonMode(GL_LINE);
+      (*lamp).Draw();
+      glState.setPolygonMode(GL_FILL);
+   }
+
+   (*uniforms).fence();
+
+   // Loads the map levels the draws of this frame asked for
+   {
+      ProfileScope scope("Texture streaming");
+      (*textureCache).stream();
+   }
+}
+
+void Viewer::setInstanceTransform(size_t index, const glm::mat4 &transform) {
+   instanceTransforms[index] = transform;
+   instanceBounds[index] = transformBounds((*model).getBounds(), transform);
+   instancesMoved = true;
+}
+
+void Viewer::pick(const Camera &camera, float aspect) const {
+   glm::vec3 origin, direction;
+   camera.getRay(0.0f, 0.0f, aspect, origin, direction);
+
+   size_t mesh;
+   float distance;
+   if ((*model).pick(origin, direction, glm::mat4(1.0f), mesh, distance))
+      debugMsg("Picking", "Mesh " + std::to_string(mesh) + " at " +
+                              std::to_string(distance));
+   else
+      debugMsg("Picking", "Nothing");
+}